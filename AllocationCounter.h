@@ -0,0 +1,56 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Number of calls of the global operator new so far. It only counts in a program that defines
+// MSBFS_COUNT_ALLOCATIONS in the one translation unit that includes this header first, which then
+// replaces operator new and delete; anywhere else it stays 0. Memory TBB takes for its own tasks does
+// not go through operator new and is not counted.
+inline std::atomic<std::uint64_t>& heapAllocationNum()
+{
+    static std::atomic<std::uint64_t> count(0);
+    return count;
+}
+
+#ifdef MSBFS_COUNT_ALLOCATIONS
+__attribute__((noinline)) void* operator new(std::size_t size)
+{
+    heapAllocationNum().fetch_add(1, std::memory_order_relaxed);
+    if(void* p = std::malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+#endif
+
+#endif
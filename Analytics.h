@@ -0,0 +1,323 @@
+#ifndef ANALYTICS_H
+#define ANALYTICS_H
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <map>
+#include <numeric>
+
+#include "tbb/enumerable_thread_specific.h"
+
+#include "Types.h"
+#include "CsrGraph.h"
+#include "MsPbfs.h"
+#include "GraphGenerators.h"
+
+// Distance based analytics on top of the parallel MS-BFS. The sources are run through the hybrid engine
+// in batches of the widest label and DistanceStatsSink adds up what the analytics need while the engine
+// reports its discoveries, so no distance is ever stored or called back per vertex:
+//
+//   closeness     Wasserman-Faust closeness (r / (n - 1)) * (r / s), r the number of other vertices a
+//                 vertex reaches and s the sum of their distances; the plain 1 / average distance on a
+//                 connected graph
+//   eccentricity  the largest distance to a reachable vertex, the diameter is the largest eccentricity
+//   apsp          the distances of all pairs, a DistanceMatrixSink over every vertex
+//
+// Exact variants run every vertex as a source. The approximate ones run k sampled sources and estimate
+// the values of every vertex from its distances to the sample (Eppstein and Wang for closeness, the
+// largest distance to a sampled source as a lower bound of the eccentricity). The graph is undirected,
+// so d(s, v) = d(v, s) and the per-target sums of a run are the per-vertex sums of the sample.
+
+// distances from one source to the other vertices it reaches
+struct SourceDistanceStats
+{
+    std::uint64_t reached;      // reachable vertices, the source not included
+    std::uint64_t distanceSum;
+    std::uint32_t eccentricity;
+    VertexId component = INVALID_VERTEX; // smallest dense id a source reaches, itself included (sources only)
+};
+
+// Per-source statistics, and on request the same per target (summed over the sources of the run).
+// Sources are counted in thread-local tables that are added up at the end of each batch. Target v is
+// reported at most once per level, from one worker, so its entries are written directly.
+template <unsigned int bitsetSize>
+class DistanceStatsSink
+{
+public:
+    DistanceStatsSink(const CsrGraph& g, std::size_t sourceNum, bool trackTargets):
+        sources(sourceNum, SourceDistanceStats{0, 0, 0}), firstSource(0), batchSize(0),
+        localStats(std::vector<SourceDistanceStats>(bitsetSize, SourceDistanceStats{0, 0, 0}))
+    {
+        if(trackTargets)
+        {
+            targets.assign(g.nodeNum(), SourceDistanceStats{0, 0, 0});
+        }
+    }
+
+    void beginBatch(std::size_t first, const VertexId* batchSources, std::size_t count)
+    {
+        firstSource = first;
+        batchSize = count;
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            sources[first + i].component = batchSources[i];
+        }
+    }
+
+    void found(std::size_t level, VertexId v, const ParallelLabel* label)
+    {
+        std::vector<SourceDistanceStats>& local = localStats.local();
+        std::uint32_t distance = level;
+        std::size_t count = 0;
+        labelForEachBit<LabelWords<bitsetSize>::count>(label, [&] (std::size_t i) {
+            ++local[i].reached;
+            local[i].distanceSum += distance;
+            local[i].eccentricity = distance; // levels only grow
+            local[i].component = std::min(local[i].component, v);
+            ++count;
+        });
+        if(!targets.empty())
+        {
+            SourceDistanceStats& target = targets[v];
+            target.reached += count;
+            target.distanceSum += count * distance;
+            target.eccentricity = std::max(target.eccentricity, distance);
+        }
+    }
+
+    void endLevel() {}
+
+    void endBatch()
+    {
+        for(auto& local: localStats)
+        {
+            for(std::size_t i = 0; i < batchSize; ++i)
+            {
+                SourceDistanceStats& source = sources[firstSource + i];
+                source.reached += local[i].reached;
+                source.distanceSum += local[i].distanceSum;
+                source.eccentricity = std::max(source.eccentricity, local[i].eccentricity);
+                source.component = std::min(source.component, local[i].component);
+                local[i] = SourceDistanceStats{0, 0, 0};
+            }
+        }
+    }
+
+    const std::vector<SourceDistanceStats>& sourceStats() const
+    {
+        return sources;
+    }
+
+    // per vertex, over all sources of the run; empty unless requested
+    const std::vector<SourceDistanceStats>& targetStats() const
+    {
+        return targets;
+    }
+private:
+    std::vector<SourceDistanceStats> sources;
+    std::vector<SourceDistanceStats> targets;
+    std::size_t firstSource;
+    std::size_t batchSize;
+    tbb::enumerable_thread_specific<std::vector<SourceDistanceStats>> localStats;
+};
+
+// Wasserman-Faust closeness of a vertex that reaches 'reached' of n vertices at a total distance of 'distanceSum'
+inline double closeness(double reached, double distanceSum, VertexId nodeNumber)
+{
+    if(distanceSum <= 0 || nodeNumber < 2)
+    {
+        return 0;
+    }
+    return reached / (nodeNumber - 1) * (reached / distanceSum);
+}
+
+// Runs the sources through the hybrid engine and returns their statistics (and those of every target if asked).
+inline std::vector<SourceDistanceStats> runDistanceStats(const CsrGraph& g, const std::vector<VertexId>& sources,
+                                                         std::vector<SourceDistanceStats>* targetStats = nullptr)
+{
+    return withLabelWidth(sources.size(), [&] (auto width) {
+        const unsigned int bitsetSize = decltype(width)::value;
+        DistanceStatsSink<bitsetSize> sink(g, sources.size(), targetStats != nullptr);
+        MsBfs<bitsetSize, DistanceStatsSink<bitsetSize>> engine(g);
+        engine.hybridMsPbfs(sources, sink);
+        if(targetStats)
+        {
+            *targetStats = sink.targetStats();
+        }
+        return sink.sourceStats();
+    });
+}
+
+inline std::vector<VertexId> allVertices(const CsrGraph& g)
+{
+    std::vector<VertexId> vertices(g.nodeNum());
+    std::iota(vertices.begin(), vertices.end(), 0);
+    return vertices;
+}
+
+// closeness of every vertex, by dense id
+inline std::vector<double> closenessCentrality(const CsrGraph& g)
+{
+    std::vector<SourceDistanceStats> stats = runDistanceStats(g, allVertices(g));
+    std::vector<double> result(g.nodeNum());
+    for(VertexId v = 0; v < g.nodeNum(); ++v)
+    {
+        result[v] = closeness(stats[v].reached, stats[v].distanceSum, g.nodeNum());
+    }
+    return result;
+}
+
+// Closeness of every vertex estimated from k sampled sources. A vertex that reaches r of the samples at
+// a total distance of s is estimated to reach r / k of the graph at an average distance of s / r.
+inline std::vector<double> approximateClosenessCentrality(const CsrGraph& g, std::size_t k, std::uint64_t seed)
+{
+    std::vector<VertexId> sample = sampleSources(g, k, seed);
+    std::vector<SourceDistanceStats> targets;
+    runDistanceStats(g, sample, &targets);
+    std::vector<double> result(g.nodeNum(), 0);
+    if(sample.empty())
+    {
+        return result;
+    }
+    for(VertexId v = 0; v < g.nodeNum(); ++v)
+    {
+        double scale = double(g.nodeNum() - 1) / sample.size();
+        result[v] = closeness(targets[v].reached * scale, targets[v].distanceSum * scale, g.nodeNum());
+    }
+    return result;
+}
+
+// eccentricity of every vertex, by dense id
+inline std::vector<std::uint32_t> eccentricities(const CsrGraph& g)
+{
+    std::vector<SourceDistanceStats> stats = runDistanceStats(g, allVertices(g));
+    std::vector<std::uint32_t> result(g.nodeNum());
+    for(VertexId v = 0; v < g.nodeNum(); ++v)
+    {
+        result[v] = stats[v].eccentricity;
+    }
+    return result;
+}
+
+// Bounds of the largest diameter of the components the sample hits. Within a component the largest
+// eccentricity of a sampled source bounds the diameter from below, twice the smallest from above.
+struct DiameterBounds
+{
+    std::uint32_t lower; // the largest eccentricity of a sampled source
+    std::uint32_t upper; // the largest upper bound of a component
+};
+
+// Lower bounds of the eccentricity of every vertex from k sampled sources, ecc(v) >= d(v, s) for every
+// sample s, and the bounds of the diameter they give.
+inline std::vector<std::uint32_t> approximateEccentricities(const CsrGraph& g, std::size_t k, std::uint64_t seed, DiameterBounds& diameter)
+{
+    std::vector<VertexId> sample = sampleSources(g, k, seed);
+    std::vector<SourceDistanceStats> targets;
+    std::vector<SourceDistanceStats> sources = runDistanceStats(g, sample, &targets);
+    std::vector<std::uint32_t> result(g.nodeNum());
+    diameter = DiameterBounds{0, 0};
+    for(VertexId v = 0; v < g.nodeNum(); ++v)
+    {
+        result[v] = targets[v].eccentricity;
+    }
+    // the bounds of each component the sample hits, keyed by the component ids of its samples
+    std::map<VertexId, DiameterBounds> components;
+    for(const SourceDistanceStats& s: sources)
+    {
+        auto inserted = components.emplace(s.component, DiameterBounds{s.eccentricity, 2 * s.eccentricity});
+        DiameterBounds& bounds = inserted.first->second;
+        bounds.lower = std::max(bounds.lower, s.eccentricity);
+        bounds.upper = std::min(bounds.upper, 2 * s.eccentricity);
+    }
+    for(const auto& component: components)
+    {
+        diameter.lower = std::max(diameter.lower, component.second.lower);
+        diameter.upper = std::max(diameter.upper, component.second.upper);
+    }
+    return result;
+}
+
+// All distances from the sources, rows by source and columns by dense vertex id.
+template <unsigned int bitsetSize>
+void allPairsDistances(const CsrGraph& g, const std::vector<VertexId>& sources, DistanceMatrixSink<bitsetSize>& matrix)
+{
+    MsBfs<bitsetSize, DistanceMatrixSink<bitsetSize>> engine(g);
+    engine.hybridMsPbfs(sources, matrix);
+}
+
+// The same statistics from a plain single-source BFS, the baseline the speedups are measured against.
+inline SourceDistanceStats singleSourceDistanceStats(const CsrGraph& g, VertexId source, std::vector<std::uint32_t>& distances,
+                                                     std::vector<VertexId>& queue)
+{
+    SourceDistanceStats stats{0, 0, 0};
+    std::fill(distances.begin(), distances.end(), std::numeric_limits<std::uint32_t>::max());
+    queue.clear();
+    distances[source] = 0;
+    queue.push_back(source);
+    for(std::size_t head = 0; head < queue.size(); ++head)
+    {
+        VertexId v = queue[head];
+        for(const VertexId* e = g.neighboursBegin(v); e != g.neighboursEnd(v); ++e)
+        {
+            if(distances[*e] == std::numeric_limits<std::uint32_t>::max())
+            {
+                distances[*e] = distances[v] + 1;
+                ++stats.reached;
+                stats.distanceSum += distances[*e];
+                stats.eccentricity = distances[*e];
+                queue.push_back(*e);
+            }
+        }
+    }
+    return stats;
+}
+
+// Time of an analytic against one single-source BFS per source. The baseline runs at most
+// 'baselineLimit' of the sources (in parallel, one BFS per worker at a time) and is scaled up to all of them.
+struct SpeedupMeasurement
+{
+    double msbfsSeconds;
+    double baselineSeconds;
+    std::size_t baselineSources;
+    bool extrapolated;
+
+    double speedup() const
+    {
+        return msbfsSeconds > 0 ? baselineSeconds / msbfsSeconds : 0;
+    }
+};
+
+inline double singleSourceSeconds(const CsrGraph& g, const std::vector<VertexId>& sources, std::size_t limit, std::size_t& measured)
+{
+    measured = std::min(limit, sources.size());
+    struct Scratch
+    {
+        std::vector<std::uint32_t> distances;
+        std::vector<VertexId> queue;
+    };
+    tbb::enumerable_thread_specific<Scratch> scratch([&] {return Scratch{std::vector<std::uint32_t>(g.nodeNum()), std::vector<VertexId>()};});
+    std::uint64_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, measured, 1), [&] (const tbb::blocked_range<std::size_t>& r) {
+        Scratch& local = scratch.local();
+        std::uint64_t localSum = 0;
+        for(std::size_t i = r.begin(); i != r.end(); ++i)
+        {
+            localSum += singleSourceDistanceStats(g, sources[i], local.distances, local.queue).distanceSum;
+        }
+        atomicFetchAdd(checksum, localSum);
+    });
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return measured > 0 ? elapsed.count() * sources.size() / measured : 0;
+}
+
+inline SpeedupMeasurement measureSpeedup(const CsrGraph& g, const std::vector<VertexId>& sources, double msbfsSeconds, std::size_t baselineLimit)
+{
+    SpeedupMeasurement measurement{msbfsSeconds, 0, 0, false};
+    measurement.baselineSeconds = singleSourceSeconds(g, sources, baselineLimit, measurement.baselineSources);
+    measurement.extrapolated = measurement.baselineSources < sources.size();
+    return measurement;
+}
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef CSRGRAPH_H
+#define CSRGRAPH_H
+
+#include <memory>
+#include <utility>
+
+#include "Types.h"
+#include "MappedFile.h"
+
+// Immutable compressed sparse row snapshot of a ListGraph.
+// Vertices are renumbered to dense ids in [0, nodeNum()), the neighbours of v are stored
+// contiguously in neighbours[offsets[v] .. offsets[v + 1]). The original LEMON ids are kept
+// so that results can be reported in terms of the input graph.
+// The arrays are either owned by the snapshot or point into a mapped graph file (see GraphFile.h),
+// so a snapshot can be moved but not copied.
+class CsrGraph
+{
+public:
+    CsrGraph(const ListGraph& g);
+    // takes over arrays built elsewhere (see EdgeListReader.h)
+    CsrGraph(std::vector<EdgeIndex>&& offsets, std::vector<VertexId>&& neighbours, std::vector<std::uint64_t>&& originalIds,
+             std::vector<VertexId>&& denseIds, std::size_t maxNodeId);
+    // adopts arrays that live in a mapped file
+    CsrGraph(std::shared_ptr<const MappedFile> file, VertexId nodeNumber, EdgeIndex edgeNumber, std::size_t maxNodeId,
+             const EdgeIndex* offsets, const VertexId* neighbours, const std::uint64_t* originalIds, const VertexId* denseIds);
+    CsrGraph(CsrGraph&&) = default;
+    CsrGraph& operator=(CsrGraph&&) = default;
+    CsrGraph(const CsrGraph&) = delete;
+    CsrGraph& operator=(const CsrGraph&) = delete;
+
+    VertexId nodeNum() const;
+    EdgeIndex edgeNum() const;
+    EdgeIndex degree(VertexId v) const;
+    const VertexId* neighboursBegin(VertexId v) const;
+    const VertexId* neighboursEnd(VertexId v) const;
+    std::size_t originalId(VertexId v) const;
+    std::size_t maxNodeId() const;
+    VertexId denseId(std::size_t originalId) const;
+
+    // the raw arrays, e.g. for writing them to a graph file
+    const EdgeIndex* offsetData() const;
+    const VertexId* neighbourData() const;
+    const std::uint64_t* originalIdData() const;
+    const VertexId* denseIdData() const;
+private:
+    void adoptStorage();
+    // storage of a snapshot built in memory, empty for a mapped one
+    std::vector<EdgeIndex> offsetStorage;
+    std::vector<VertexId> neighbourStorage;
+    std::vector<std::uint64_t> originalIdStorage;  // dense id -> LEMON id
+    std::vector<VertexId> denseIdStorage;          // LEMON id -> dense id
+    std::shared_ptr<const MappedFile> file;
+    const EdgeIndex* offsets;
+    const VertexId* neighbours;
+    const std::uint64_t* originalIds;
+    const VertexId* denseIds;
+    VertexId nodeNumber;
+    EdgeIndex edgeNumber;
+    std::size_t maxId;
+};
+
+inline CsrGraph::CsrGraph(const ListGraph& g): maxId(g.maxNodeId())
+{
+    VertexId nodeCount = countNodes(g);
+
+    originalIdStorage.reserve(nodeCount);
+    denseIdStorage.assign(maxId + 1, INVALID_VERTEX);
+    offsetStorage.assign(nodeCount + 1, 0);
+
+    // first pass: dense ids and degrees
+    for (ListGraph::NodeIt n(g); n != INVALID; ++n)
+    {
+        VertexId v = originalIdStorage.size();
+        denseIdStorage[g.id(n)] = v;
+        originalIdStorage.push_back(g.id(n));
+        for (ListGraph::IncEdgeIt e(g, n); e != INVALID; ++e)
+        {
+            ++offsetStorage[v + 1];
+        }
+    }
+
+    for (VertexId v = 0; v < nodeCount; ++v)
+    {
+        offsetStorage[v + 1] += offsetStorage[v];
+    }
+
+    // second pass: neighbour lists, in the same order as IncEdgeIt would visit them
+    neighbourStorage.resize(offsetStorage[nodeCount]);
+    for (ListGraph::NodeIt n(g); n != INVALID; ++n)
+    {
+        EdgeIndex pos = offsetStorage[denseIdStorage[g.id(n)]];
+        for (ListGraph::IncEdgeIt e(g, n); e != INVALID; ++e)
+        {
+            neighbourStorage[pos++] = denseIdStorage[g.id(g.runningNode(e))];
+        }
+    }
+    adoptStorage();
+}
+
+inline CsrGraph::CsrGraph(std::vector<EdgeIndex>&& offsets_, std::vector<VertexId>&& neighbours_, std::vector<std::uint64_t>&& originalIds_,
+                          std::vector<VertexId>&& denseIds_, std::size_t maxNodeId):
+    offsetStorage(std::move(offsets_)), neighbourStorage(std::move(neighbours_)), originalIdStorage(std::move(originalIds_)),
+    denseIdStorage(std::move(denseIds_)), maxId(maxNodeId)
+{
+    adoptStorage();
+}
+
+inline CsrGraph::CsrGraph(std::shared_ptr<const MappedFile> file_, VertexId nodeNumber_, EdgeIndex edgeNumber_, std::size_t maxNodeId,
+                          const EdgeIndex* offsets_, const VertexId* neighbours_, const std::uint64_t* originalIds_, const VertexId* denseIds_):
+    file(file_), offsets(offsets_), neighbours(neighbours_), originalIds(originalIds_), denseIds(denseIds_),
+    nodeNumber(nodeNumber_), edgeNumber(edgeNumber_), maxId(maxNodeId)
+{}
+
+inline void CsrGraph::adoptStorage()
+{
+    offsets = offsetStorage.data();
+    neighbours = neighbourStorage.data();
+    originalIds = originalIdStorage.data();
+    denseIds = denseIdStorage.data();
+    nodeNumber = originalIdStorage.size();
+    edgeNumber = neighbourStorage.size();
+}
+
+inline VertexId CsrGraph::nodeNum() const
+{
+    return nodeNumber;
+}
+
+inline EdgeIndex CsrGraph::edgeNum() const
+{
+    return edgeNumber;
+}
+
+inline EdgeIndex CsrGraph::degree(VertexId v) const
+{
+    return offsets[v + 1] - offsets[v];
+}
+
+inline const VertexId* CsrGraph::neighboursBegin(VertexId v) const
+{
+    return neighbours + offsets[v];
+}
+
+inline const VertexId* CsrGraph::neighboursEnd(VertexId v) const
+{
+    return neighbours + offsets[v + 1];
+}
+
+inline std::size_t CsrGraph::originalId(VertexId v) const
+{
+    return originalIds[v];
+}
+
+inline std::size_t CsrGraph::maxNodeId() const
+{
+    return maxId;
+}
+
+inline VertexId CsrGraph::denseId(std::size_t originalId) const
+{
+    return denseIds[originalId];
+}
+
+inline const EdgeIndex* CsrGraph::offsetData() const
+{
+    return offsets;
+}
+
+inline const VertexId* CsrGraph::neighbourData() const
+{
+    return neighbours;
+}
+
+inline const std::uint64_t* CsrGraph::originalIdData() const
+{
+    return originalIds;
+}
+
+inline const VertexId* CsrGraph::denseIdData() const
+{
+    return denseIds;
+}
+
+#endif
@@ -0,0 +1,426 @@
+#ifndef DISTANCEFILE_H
+#define DISTANCEFILE_H
+
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "Types.h"
+#include "CsrGraph.h"
+#include "MappedFile.h"
+#include "GraphFile.h"
+
+// Distance file: the distance of every vertex from every source of a run, packed and written in place
+// by DistanceFileSink while the engine traverses, so that later jobs can look distances up in a mapping
+// instead of rerunning the traversal or parsing a text dump. Layout (native byte order):
+//
+//   header         DistanceFileHeader, 64 bytes
+//   sourceIds      sourceNum uint64, original ids of the sources
+//   vertexIds      nodeNum uint64, original ids of the vertices (the columns)
+//   matrix         by vertex, then source
+//
+// Every section starts at a multiple of GRAPH_FILE_ALIGNMENT. The matrix is encoded as
+//
+//   u8       one byte per (vertex, source), DEPTH8_UNREACHED where there is no path
+//   u16      two bytes per (vertex, source), DEPTH16_UNREACHED where there is no path
+//   planes   bit-sliced levels: per vertex and group of 64 sources, planeNum + 1 words; bit i of word 0
+//            is set if source i of the group reaches the vertex and bit i of word p + 1 is bit p of its
+//            distance. The sink writes a whole label word per plane, so no depth is written bit by bit,
+//            and a graph of diameter below 2^p takes p + 1 bits per pair
+//
+// The sink assumes that every batch of the run starts at a multiple of 64 sources, which holds for any
+// engine of at least one label word. A distance beyond the encoding makes finish() throw.
+
+const char DISTANCE_FILE_MAGIC[8] = {'M', 'S', 'B', 'F', 'S', 'D', 'S', 'T'};
+const std::uint32_t DISTANCE_FILE_VERSION = 1;
+const std::uint8_t DEPTH8_UNREACHED = std::numeric_limits<std::uint8_t>::max();
+const std::uint16_t DEPTH16_UNREACHED = std::numeric_limits<std::uint16_t>::max();
+
+enum class DistanceEncoding : std::uint32_t
+{
+    Depth8 = 0,
+    Depth16,
+    LevelPlanes
+};
+
+inline const char* distanceEncodingName(DistanceEncoding encoding)
+{
+    switch(encoding)
+    {
+        case DistanceEncoding::Depth8: return "u8";
+        case DistanceEncoding::Depth16: return "u16";
+        case DistanceEncoding::LevelPlanes: return "planes";
+    }
+    return "unknown";
+}
+
+// "u8", "u16" or "planes:p" with p level planes (distances up to 2^p - 1)
+inline DistanceEncoding parseDistanceEncoding(const std::string& name, std::uint32_t& planeNum)
+{
+    planeNum = 0;
+    if(name == distanceEncodingName(DistanceEncoding::Depth8))
+    {
+        return DistanceEncoding::Depth8;
+    }
+    if(name == distanceEncodingName(DistanceEncoding::Depth16))
+    {
+        return DistanceEncoding::Depth16;
+    }
+    if(name.compare(0, 7, "planes:") == 0)
+    {
+        planeNum = std::stoul(name.substr(7));
+        if(planeNum >= 1 && planeNum <= 32)
+        {
+            return DistanceEncoding::LevelPlanes;
+        }
+    }
+    throw std::runtime_error("unknown distance encoding " + name + " (u8, u16 or planes:1 to planes:32)");
+}
+
+struct DistanceFileHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t encoding;     // DistanceEncoding
+    std::uint64_t nodeNum;
+    std::uint64_t sourceNum;
+    std::uint64_t planeNum;     // level planes, 0 for the byte encodings
+    std::uint64_t maxDistance;  // largest finite distance in the file
+    std::uint64_t reserved[2];
+};
+
+static_assert(sizeof(DistanceFileHeader) == GRAPH_FILE_ALIGNMENT, "the header fills the first section");
+
+// section offsets of a distance file, the last one is the file size
+struct DistanceFileLayout
+{
+    std::size_t sourceIds;
+    std::size_t vertexIds;
+    std::size_t matrix;
+    std::size_t end;
+    std::size_t groupNum;     // groups of 64 sources, planes only
+    std::size_t vertexBytes;  // matrix bytes per vertex
+
+    DistanceFileLayout(const DistanceFileHeader& header)
+    {
+        groupNum = (header.sourceNum + LABEL_WORD_BITS - 1) / LABEL_WORD_BITS;
+        switch(static_cast<DistanceEncoding>(header.encoding))
+        {
+            case DistanceEncoding::Depth8: vertexBytes = header.sourceNum; break;
+            case DistanceEncoding::Depth16: vertexBytes = header.sourceNum * sizeof(std::uint16_t); break;
+            case DistanceEncoding::LevelPlanes: vertexBytes = groupNum * (header.planeNum + 1) * sizeof(ParallelLabel); break;
+            default: throw std::runtime_error("unknown distance encoding");
+        }
+        sourceIds = sizeof(DistanceFileHeader);
+        vertexIds = alignGraphSection(sourceIds + header.sourceNum * sizeof(std::uint64_t));
+        matrix = alignGraphSection(vertexIds + header.nodeNum * sizeof(std::uint64_t));
+        end = matrix + header.nodeNum * vertexBytes;
+    }
+};
+
+// Writes the distances of a run straight into a new distance file. Each (vertex, level) is reported by
+// one worker, so the workers write their cells without synchronization.
+template <unsigned int bitsetSize>
+class DistanceFileSink
+{
+public:
+    DistanceFileSink(const std::string& path, const CsrGraph& g, const std::vector<VertexId>& sources,
+                     DistanceEncoding encoding, std::uint32_t planeNum = 0);
+
+    void beginBatch(std::size_t first, const VertexId* sources, std::size_t count);
+    void found(std::size_t level, VertexId v, const ParallelLabel* label);
+    void endLevel() {}
+    void endBatch() {}
+
+    // completes the header and writes the file back, throws if a distance did not fit
+    void finish();
+    std::size_t fileSize() const;
+private:
+    void setDistance(VertexId v, std::size_t source, std::size_t level);
+    DistanceFileHeader header;
+    DistanceFileLayout layout;
+    MappedOutputFile file;
+    char* matrix;
+    std::size_t firstSource;
+    std::size_t limit;        // largest distance the encoding holds
+    std::atomic<std::size_t> maxDistance;
+    std::atomic<bool> overflow;
+};
+
+inline DistanceFileHeader distanceFileHeader(const CsrGraph& g, std::size_t sourceNum, DistanceEncoding encoding, std::uint32_t planeNum)
+{
+    DistanceFileHeader header = {};
+    std::memcpy(header.magic, DISTANCE_FILE_MAGIC, sizeof(header.magic));
+    header.version = DISTANCE_FILE_VERSION;
+    header.encoding = static_cast<std::uint32_t>(encoding);
+    header.nodeNum = g.nodeNum();
+    header.sourceNum = sourceNum;
+    header.planeNum = encoding == DistanceEncoding::LevelPlanes ? planeNum : 0;
+    return header;
+}
+
+template <unsigned int bitsetSize>
+DistanceFileSink<bitsetSize>::DistanceFileSink(const std::string& path, const CsrGraph& g, const std::vector<VertexId>& sources,
+                                               DistanceEncoding encoding, std::uint32_t planeNum):
+    header(distanceFileHeader(g, sources.size(), encoding, planeNum)), layout(header), file(path, layout.end),
+    matrix(file.data() + layout.matrix), firstSource(0), maxDistance(0), overflow(false)
+{
+    static_assert(bitsetSize % LABEL_WORD_BITS == 0, "batches have to start at a group of 64 sources");
+    std::uint64_t* sourceIds = reinterpret_cast<std::uint64_t*>(file.data() + layout.sourceIds);
+    for(std::size_t i = 0; i < sources.size(); ++i)
+    {
+        sourceIds[i] = g.originalId(sources[i]);
+    }
+    std::uint64_t* vertexIds = reinterpret_cast<std::uint64_t*>(file.data() + layout.vertexIds);
+    for(VertexId v = 0; v < g.nodeNum(); ++v)
+    {
+        vertexIds[v] = g.originalId(v);
+    }
+
+    // the planes start out unreached as zeros, the depths need their marker
+    switch(encoding)
+    {
+        case DistanceEncoding::Depth8:
+            limit = DEPTH8_UNREACHED - 1;
+            std::memset(matrix, DEPTH8_UNREACHED, layout.end - layout.matrix);
+            break;
+        case DistanceEncoding::Depth16:
+            limit = DEPTH16_UNREACHED - 1;
+            std::memset(matrix, 0xff, layout.end - layout.matrix);
+            break;
+        case DistanceEncoding::LevelPlanes:
+            limit = (std::size_t(1) << header.planeNum) - 1;
+            break;
+    }
+}
+
+template <unsigned int bitsetSize>
+void DistanceFileSink<bitsetSize>::setDistance(VertexId v, std::size_t source, std::size_t level)
+{
+    if(header.encoding == static_cast<std::uint32_t>(DistanceEncoding::Depth8))
+    {
+        reinterpret_cast<std::uint8_t*>(matrix)[v * layout.vertexBytes + source] = level;
+    }
+    else
+    {
+        reinterpret_cast<std::uint16_t*>(matrix + v * layout.vertexBytes)[source] = level;
+    }
+}
+
+template <unsigned int bitsetSize>
+void DistanceFileSink<bitsetSize>::beginBatch(std::size_t first, const VertexId* sources, std::size_t count)
+{
+    firstSource = first;
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        std::size_t source = first + i;
+        if(header.encoding == static_cast<std::uint32_t>(DistanceEncoding::LevelPlanes))
+        {
+            // reached at distance 0, the level planes stay clear
+            ParallelLabel* words = reinterpret_cast<ParallelLabel*>(matrix + sources[i] * layout.vertexBytes)
+                                   + source / LABEL_WORD_BITS * (header.planeNum + 1);
+            words[0] |= ParallelLabel(1) << (source % LABEL_WORD_BITS);
+        }
+        else
+        {
+            setDistance(sources[i], source, 0);
+        }
+    }
+}
+
+template <unsigned int bitsetSize>
+void DistanceFileSink<bitsetSize>::found(std::size_t level, VertexId v, const ParallelLabel* label)
+{
+    if(level > limit)
+    {
+        overflow.store(true, std::memory_order_relaxed);
+        return;
+    }
+    if(level > maxDistance.load(std::memory_order_relaxed))
+    {
+        maxDistance.store(level, std::memory_order_relaxed); // levels of a batch only grow, a lost race loses an equal value
+    }
+    if(header.encoding == static_cast<std::uint32_t>(DistanceEncoding::LevelPlanes))
+    {
+        ParallelLabel* words = reinterpret_cast<ParallelLabel*>(matrix + v * layout.vertexBytes)
+                               + firstSource / LABEL_WORD_BITS * (header.planeNum + 1);
+        for(std::size_t w = 0; w < LabelWords<bitsetSize>::count; ++w, words += header.planeNum + 1)
+        {
+            if(label[w] == 0)
+            {
+                continue;
+            }
+            words[0] |= label[w];
+            for(std::size_t p = 0; (level >> p) != 0; ++p)
+            {
+                if((level >> p) & 1)
+                {
+                    words[p + 1] |= label[w];
+                }
+            }
+        }
+        return;
+    }
+    labelForEachBit<LabelWords<bitsetSize>::count>(label, [&] (std::size_t i) {
+        setDistance(v, firstSource + i, level);
+    });
+}
+
+template <unsigned int bitsetSize>
+void DistanceFileSink<bitsetSize>::finish()
+{
+    if(overflow.load())
+    {
+        throw std::runtime_error(std::string("distances exceed the ") + distanceEncodingName(static_cast<DistanceEncoding>(header.encoding))
+                                 + " encoding, the file is incomplete");
+    }
+    header.maxDistance = maxDistance.load();
+    std::memcpy(file.data(), &header, sizeof(header));
+    file.sync();
+}
+
+template <unsigned int bitsetSize>
+std::size_t DistanceFileSink<bitsetSize>::fileSize() const
+{
+    return layout.end;
+}
+
+// Read access to a mapped distance file.
+class DistanceFile
+{
+public:
+    static const std::uint32_t UNREACHED = std::numeric_limits<std::uint32_t>::max();
+
+    DistanceFile(const std::string& path);
+
+    std::size_t sourceNum() const;
+    std::size_t nodeNum() const;
+    DistanceEncoding encoding() const;
+    std::size_t maxDistance() const;
+    std::uint64_t sourceId(std::size_t source) const;
+    std::uint64_t vertexId(std::size_t column) const;
+    // index of a source / column of a vertex by original id, or the count if there is none
+    std::size_t sourceIndex(std::uint64_t originalId) const;
+    std::size_t vertexColumn(std::uint64_t originalId) const;
+    // distance of column from source i, UNREACHED if there is no path
+    std::uint32_t distance(std::size_t source, std::size_t column) const;
+private:
+    MappedFile file;
+    DistanceFileHeader header;
+    DistanceFileLayout layout;
+    std::unordered_map<std::uint64_t, std::size_t> sourceIndices;
+    std::unordered_map<std::uint64_t, std::size_t> vertexColumns;
+};
+
+inline DistanceFileHeader readDistanceFileHeader(const MappedFile& file, const std::string& path)
+{
+    DistanceFileHeader header;
+    if(file.size() < sizeof(header))
+    {
+        throw std::runtime_error(path + " is not a distance file");
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if(std::memcmp(header.magic, DISTANCE_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != DISTANCE_FILE_VERSION)
+    {
+        throw std::runtime_error(path + " is not a distance file of version " + std::to_string(DISTANCE_FILE_VERSION));
+    }
+    return header;
+}
+
+inline DistanceFile::DistanceFile(const std::string& path): file(path), header(readDistanceFileHeader(file, path)), layout(header)
+{
+    if(file.size() < layout.end)
+    {
+        throw std::runtime_error(path + " is truncated");
+    }
+    for(std::size_t i = 0; i < header.sourceNum; ++i)
+    {
+        sourceIndices.emplace(sourceId(i), i);
+    }
+    for(std::size_t v = 0; v < header.nodeNum; ++v)
+    {
+        vertexColumns.emplace(vertexId(v), v);
+    }
+}
+
+inline std::size_t DistanceFile::sourceNum() const
+{
+    return header.sourceNum;
+}
+
+inline std::size_t DistanceFile::nodeNum() const
+{
+    return header.nodeNum;
+}
+
+inline DistanceEncoding DistanceFile::encoding() const
+{
+    return static_cast<DistanceEncoding>(header.encoding);
+}
+
+inline std::size_t DistanceFile::maxDistance() const
+{
+    return header.maxDistance;
+}
+
+inline std::uint64_t DistanceFile::sourceId(std::size_t source) const
+{
+    return reinterpret_cast<const std::uint64_t*>(file.data() + layout.sourceIds)[source];
+}
+
+inline std::uint64_t DistanceFile::vertexId(std::size_t column) const
+{
+    return reinterpret_cast<const std::uint64_t*>(file.data() + layout.vertexIds)[column];
+}
+
+inline std::size_t DistanceFile::sourceIndex(std::uint64_t originalId) const
+{
+    auto it = sourceIndices.find(originalId);
+    return it == sourceIndices.end() ? header.sourceNum : it->second;
+}
+
+inline std::size_t DistanceFile::vertexColumn(std::uint64_t originalId) const
+{
+    auto it = vertexColumns.find(originalId);
+    return it == vertexColumns.end() ? header.nodeNum : it->second;
+}
+
+inline std::uint32_t DistanceFile::distance(std::size_t source, std::size_t column) const
+{
+    const char* cells = file.data() + layout.matrix + column * layout.vertexBytes;
+    switch(encoding())
+    {
+        case DistanceEncoding::Depth8:
+        {
+            std::uint8_t depth = reinterpret_cast<const std::uint8_t*>(cells)[source];
+            return depth == DEPTH8_UNREACHED ? UNREACHED : depth;
+        }
+        case DistanceEncoding::Depth16:
+        {
+            std::uint16_t depth = reinterpret_cast<const std::uint16_t*>(cells)[source];
+            return depth == DEPTH16_UNREACHED ? UNREACHED : depth;
+        }
+        case DistanceEncoding::LevelPlanes:
+        {
+            const ParallelLabel* words = reinterpret_cast<const ParallelLabel*>(cells) + source / LABEL_WORD_BITS * (header.planeNum + 1);
+            ParallelLabel bit = ParallelLabel(1) << (source % LABEL_WORD_BITS);
+            if(!(words[0] & bit))
+            {
+                return UNREACHED;
+            }
+            std::uint32_t depth = 0;
+            for(std::size_t p = 0; p < header.planeNum; ++p)
+            {
+                depth |= std::uint32_t((words[p + 1] & bit) != 0) << p;
+            }
+            return depth;
+        }
+    }
+    return UNREACHED;
+}
+
+#endif
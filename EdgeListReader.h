@@ -0,0 +1,327 @@
+#ifndef EDGELISTREADER_H
+#define EDGELISTREADER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+#include "tbb/parallel_reduce.h"
+#include "tbb/task_arena.h"
+
+#include "Types.h"
+#include "CsrGraph.h"
+#include "MappedFile.h"
+
+// Parallel reader of SNAP style edge lists ("u v" per line, '#' or '%' comments) and Matrix Market
+// coordinate files. The file is mapped and cut into chunks at line boundaries. The chunks are parsed
+// by the workers three times, so apart from the graph itself only per-id counters are kept in memory:
+//
+//   1. the largest id (Matrix Market files state it in their size line, so this pass is skipped)
+//   2. the degree of every id, counted with atomic adds
+//   3. every edge scattered into its slots, claimed with atomic adds on per-id cursors
+//
+// Edges are undirected, both directions are stored. The ids that occur become the vertices in
+// increasing order, self-loops and parallel edges are dropped on request.
+
+struct EdgeListOptions
+{
+    bool removeSelfLoops = true;
+    bool removeDuplicates = true;
+};
+
+struct EdgeListStats
+{
+    std::uint64_t lines;      // edge lines read
+    std::uint64_t selfLoops;  // dropped self-loops
+    std::uint64_t duplicates; // dropped parallel edges (adjacency entries)
+    double seconds;
+
+    double edgesPerSecond() const
+    {
+        return seconds > 0 ? lines / seconds : 0;
+    }
+};
+
+// an edge list mapped and cut into chunks
+class EdgeListFile
+{
+public:
+    // about this many chunks per worker, so that a slow chunk does not hold up a pass
+    static const std::size_t CHUNKS_PER_THREAD = 16;
+    static const std::size_t MIN_CHUNK_SIZE = 1 << 20;
+
+    EdgeListFile(const std::string& path_);
+
+    // the largest id in the size line of a Matrix Market file, 0 for plain edge lists
+    // (Matrix Market ids start at 1, they are kept as they are)
+    std::uint64_t declaredMaxId() const;
+    std::size_t chunkNum() const;
+    // calls f(u, v) for every edge line of chunk i, throws on an id above declaredMaxId()
+    template <typename Function>
+    void parseChunk(std::size_t i, Function f) const;
+private:
+    void findChunks(const char* begin, const char* end);
+    // 1-based number of the line starting at p, only for error messages
+    std::size_t lineNumber(const char* p) const;
+    std::string path;
+    MappedFile file;
+    std::uint64_t maxId;
+    std::vector<const char*> chunkBegins; // chunk i is [chunkBegins[i], chunkBegins[i + 1])
+};
+
+const std::size_t EdgeListFile::CHUNKS_PER_THREAD;
+const std::size_t EdgeListFile::MIN_CHUNK_SIZE;
+
+inline bool isLineEnd(char c)
+{
+    return c == '\n';
+}
+
+inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// parses an unsigned number at p, returns false if there is none before the end of the line
+inline bool parseId(const char*& p, const char* end, std::uint64_t& value)
+{
+    while(p != end && isBlank(*p))
+    {
+        ++p;
+    }
+    if(p == end || *p < '0' || *p > '9')
+    {
+        return false;
+    }
+    value = 0;
+    while(p != end && *p >= '0' && *p <= '9')
+    {
+        value = value * 10 + (*p - '0');
+        ++p;
+    }
+    return true;
+}
+
+inline const char* skipLine(const char* p, const char* end)
+{
+    const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    return lineEnd ? lineEnd + 1 : end;
+}
+
+inline EdgeListFile::EdgeListFile(const std::string& path_): path(path_), file(path_), maxId(0)
+{
+    const char* begin = file.data();
+    const char* end = begin + file.size();
+
+    // Matrix Market: banner, comments, then "rows columns entries"
+    const char banner[] = "%%MatrixMarket";
+    if(file.size() >= sizeof(banner) - 1 && std::memcmp(begin, banner, sizeof(banner) - 1) == 0)
+    {
+        if(!std::strstr(std::string(begin, skipLine(begin, end)).c_str(), "coordinate"))
+        {
+            throw std::runtime_error(path + ": only coordinate Matrix Market files are supported");
+        }
+        while(begin != end && (*begin == '%' || isLineEnd(*begin)))
+        {
+            begin = skipLine(begin, end);
+        }
+        const char* p = begin;
+        std::uint64_t rows, columns;
+        if(!parseId(p, end, rows) || !parseId(p, end, columns))
+        {
+            throw std::runtime_error(path + ": missing Matrix Market size line");
+        }
+        maxId = std::max(rows, columns);
+        begin = skipLine(p, end);
+    }
+    findChunks(begin, end);
+}
+
+inline void EdgeListFile::findChunks(const char* begin, const char* end)
+{
+    std::size_t threadNumber = std::max(1, tbb::this_task_arena::max_concurrency());
+    std::size_t chunkSize = std::max<std::size_t>(MIN_CHUNK_SIZE, (end - begin) / (threadNumber * CHUNKS_PER_THREAD) + 1);
+
+    chunkBegins.push_back(begin);
+    for(const char* p = begin + chunkSize; p < end; p += chunkSize)
+    {
+        // move the cut behind the next line end
+        p = skipLine(p, end);
+        if(p == end)
+        {
+            break;
+        }
+        chunkBegins.push_back(p);
+    }
+    chunkBegins.push_back(end);
+}
+
+inline std::size_t EdgeListFile::lineNumber(const char* p) const
+{
+    return std::count(file.data(), p, '\n') + 1;
+}
+
+inline std::uint64_t EdgeListFile::declaredMaxId() const
+{
+    return maxId;
+}
+
+inline std::size_t EdgeListFile::chunkNum() const
+{
+    return chunkBegins.size() - 1;
+}
+
+template <typename Function>
+void EdgeListFile::parseChunk(std::size_t i, Function f) const
+{
+    const char* p = chunkBegins[i];
+    const char* end = chunkBegins[i + 1];
+    while(p != end)
+    {
+        const char* line = p;
+        std::uint64_t u, v;
+        if(*p != '#' && *p != '%' && parseId(p, end, u) && parseId(p, end, v))
+        {
+            // the passes index their per-id arrays with the ids, sized by the declaration
+            if(maxId != 0 && (u > maxId || v > maxId))
+            {
+                throw std::runtime_error(path + ":" + std::to_string(lineNumber(line)) + ": entry " + std::to_string(u) + " "
+                                         + std::to_string(v) + " lies outside the declared size " + std::to_string(maxId));
+            }
+            f(u, v);
+        }
+        // the rest of the line, e.g. a weight or a Matrix Market value
+        p = skipLine(p, end);
+    }
+}
+
+// runs f(i) for every chunk on the workers
+template <typename Function>
+void forEachChunk(const EdgeListFile& file, Function f)
+{
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, file.chunkNum(), 1), [&] (const tbb::blocked_range<std::size_t>& r) {
+        for(std::size_t i = r.begin(); i != r.end(); ++i)
+        {
+            f(i);
+        }
+    });
+}
+
+// sorts every adjacency list and drops parallel edges, returns the number of dropped entries
+inline std::uint64_t removeDuplicateNeighbours(std::vector<EdgeIndex>& offsets, std::vector<VertexId>& neighbours)
+{
+    VertexId nodeNumber = offsets.size() - 1;
+    std::vector<EdgeIndex> degrees(nodeNumber);
+    tbb::parallel_for(tbb::blocked_range<VertexId>(0, nodeNumber), [&] (const tbb::blocked_range<VertexId>& r) {
+        for(VertexId v = r.begin(); v != r.end(); ++v)
+        {
+            VertexId* first = neighbours.data() + offsets[v];
+            VertexId* last = neighbours.data() + offsets[v + 1];
+            std::sort(first, last);
+            degrees[v] = std::unique(first, last) - first;
+        }
+    });
+    // compact in place, every list only moves towards the front
+    EdgeIndex position = 0;
+    for(VertexId v = 0; v < nodeNumber; ++v)
+    {
+        std::move(neighbours.begin() + offsets[v], neighbours.begin() + offsets[v] + degrees[v], neighbours.begin() + position);
+        offsets[v] = position;
+        position += degrees[v];
+    }
+    std::uint64_t duplicates = neighbours.size() - position;
+    offsets[nodeNumber] = position;
+    neighbours.resize(position);
+    neighbours.shrink_to_fit();
+    return duplicates;
+}
+
+inline CsrGraph readEdgeList(const std::string& path, const EdgeListOptions& options, EdgeListStats& stats)
+{
+    auto start = std::chrono::steady_clock::now();
+    EdgeListFile file(path);
+
+    // 1. largest id
+    std::uint64_t maxId = file.declaredMaxId();
+    if(maxId == 0)
+    {
+        maxId = tbb::parallel_reduce(tbb::blocked_range<std::size_t>(0, file.chunkNum(), 1), std::uint64_t(0),
+            [&] (const tbb::blocked_range<std::size_t>& r, std::uint64_t localMax) {
+                for(std::size_t i = r.begin(); i != r.end(); ++i)
+                {
+                    file.parseChunk(i, [&] (std::uint64_t u, std::uint64_t v) {
+                        localMax = std::max(localMax, std::max(u, v));
+                    });
+                }
+                return localMax;
+            },
+            [] (std::uint64_t a, std::uint64_t b) {return std::max(a, b);});
+    }
+    if(maxId >= INVALID_VERTEX)
+    {
+        throw std::runtime_error(path + ": vertex ids do not fit into VertexId");
+    }
+
+    // 2. degrees by id
+    std::vector<std::uint64_t> counters(maxId + 1, 0);
+    std::uint64_t lines = 0;
+    std::uint64_t selfLoops = 0;
+    forEachChunk(file, [&] (std::size_t i) {
+        std::uint64_t localLines = 0, localSelfLoops = 0;
+        file.parseChunk(i, [&] (std::uint64_t u, std::uint64_t v) {
+            ++localLines;
+            if(u == v && options.removeSelfLoops)
+            {
+                ++localSelfLoops;
+                return;
+            }
+            atomicFetchAdd(counters[u], 1);
+            atomicFetchAdd(counters[v], 1);
+        });
+        atomicFetchAdd(lines, localLines);
+        atomicFetchAdd(selfLoops, localSelfLoops);
+    });
+
+    // dense ids and offsets, the counters become the next free slot of each id
+    std::vector<VertexId> denseIds(maxId + 1, INVALID_VERTEX);
+    std::vector<std::uint64_t> originalIds;
+    std::vector<EdgeIndex> offsets(1, 0);
+    for(std::uint64_t id = 0; id <= maxId; ++id)
+    {
+        if(counters[id] == 0)
+        {
+            continue;
+        }
+        denseIds[id] = originalIds.size();
+        originalIds.push_back(id);
+        EdgeIndex degree = counters[id];
+        counters[id] = offsets.back();
+        offsets.push_back(offsets.back() + degree);
+    }
+
+    // 3. scatter
+    std::vector<VertexId> neighbours(offsets.back());
+    forEachChunk(file, [&] (std::size_t i) {
+        file.parseChunk(i, [&] (std::uint64_t u, std::uint64_t v) {
+            if(u == v && options.removeSelfLoops)
+            {
+                return;
+            }
+            neighbours[atomicFetchAdd(counters[u], 1)] = denseIds[v];
+            neighbours[atomicFetchAdd(counters[v], 1)] = denseIds[u];
+        });
+    });
+    std::vector<std::uint64_t>().swap(counters);
+
+    std::uint64_t duplicates = options.removeDuplicates ? removeDuplicateNeighbours(offsets, neighbours) : 0;
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    stats = EdgeListStats{lines, selfLoops, duplicates, elapsed.count()};
+    return CsrGraph(std::move(offsets), std::move(neighbours), std::move(originalIds), std::move(denseIds), maxId);
+}
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef ENGINEARENA_H
+#define ENGINEARENA_H
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include "Types.h"
+
+// One block of memory for the run state of an engine: the vertex lists of the levels, the per-worker
+// list chunks and hub buffers. It is reserved once with the size the engine computes from the vertex
+// count, the worker slots and the hubs, carved up front and never grows, so nothing of a run (and in
+// particular nothing inside the level loop) goes to the heap. The pages come from an anonymous mapping
+// without swap reservation: they read as zero and only the ones a run touches become resident.
+// discard() gives all of them back to the kernel in one step (the state is carved again from scratch
+// afterwards), unmapping the block with the engine does too.
+class EngineArena
+{
+public:
+    static const std::size_t ALIGNMENT = 64;
+
+    EngineArena();
+    ~EngineArena();
+    EngineArena(const EngineArena&) = delete;
+    EngineArena& operator=(const EngineArena&) = delete;
+
+    // maps the block, any block mapped before is released
+    void reserve(std::size_t bytes);
+    // the next count Ts of the block (zero, aligned to a cache line), throws if the block is exhausted
+    template <typename T>
+    T* carve(std::size_t count);
+    // returns the pages to the kernel and forgets what was carved, what is carved next reads as zero again
+    void discard();
+
+    std::size_t reservedBytes() const;
+    std::size_t carvedBytes() const;
+    // size of count Ts as carve() lays them out
+    template <typename T>
+    static std::size_t carvedSize(std::size_t count);
+private:
+    char* base;
+    std::size_t capacity;
+    std::size_t used;
+};
+
+inline EngineArena::EngineArena(): base(nullptr), capacity(0), used(0)
+{}
+
+inline EngineArena::~EngineArena()
+{
+    if(base)
+    {
+        munmap(base, capacity);
+    }
+}
+
+inline void EngineArena::reserve(std::size_t bytes)
+{
+    if(base)
+    {
+        munmap(base, capacity);
+        base = nullptr;
+    }
+    capacity = bytes > ALIGNMENT ? bytes : ALIGNMENT;
+    used = 0;
+    void* block = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(block == MAP_FAILED)
+    {
+        capacity = 0;
+        throw std::bad_alloc();
+    }
+    base = static_cast<char*>(block);
+}
+
+template <typename T>
+T* EngineArena::carve(std::size_t count)
+{
+    std::size_t size = carvedSize<T>(count);
+    if(used + size > capacity)
+    {
+        throw std::runtime_error("engine arena exhausted: " + std::to_string(used + size) + " of " + std::to_string(capacity) + " bytes");
+    }
+    T* result = reinterpret_cast<T*>(base + used);
+    used += size;
+    return result;
+}
+
+inline void EngineArena::discard()
+{
+    if(base)
+    {
+        madvise(base, capacity, MADV_DONTNEED);
+    }
+    used = 0;
+}
+
+inline std::size_t EngineArena::reservedBytes() const
+{
+    return capacity;
+}
+
+inline std::size_t EngineArena::carvedBytes() const
+{
+    return used;
+}
+
+template <typename T>
+std::size_t EngineArena::carvedSize(std::size_t count)
+{
+    return (count * sizeof(T) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+// A list of at most 'capacity' trivial entries in memory it does not own, with the vector operations
+// the engine needs. It never allocates; exceeding the capacity is a bug of the caller, which debug
+// builds assert on (the arena lies in one mapping, so nothing else would notice).
+template <typename T>
+class ArenaList
+{
+public:
+    ArenaList(): items(nullptr), count(0), capacityNum(0) {}
+
+    void attach(T* storage, std::size_t capacity)
+    {
+        items = storage;
+        count = 0;
+        capacityNum = capacity;
+    }
+
+    std::size_t size() const { return count; }
+    std::size_t capacity() const { return capacityNum; }
+    T* begin() { return items; }
+    T* end() { return items + count; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+    T& operator[](std::size_t i) { return items[i]; }
+    const T& operator[](std::size_t i) const { return items[i]; }
+
+    void clear() { count = 0; }
+    void push_back(const T& item)
+    {
+        assert(count < capacityNum);
+        items[count++] = item;
+    }
+    // drops the entries from position n on
+    void truncate(std::size_t n) { count = std::min(count, n); }
+    template <typename Iterator>
+    void append(Iterator first, Iterator last)
+    {
+        assert(std::size_t(std::distance(first, last)) <= capacityNum - count);
+        count = std::copy(first, last, items + count) - items;
+    }
+    template <typename Iterator>
+    void assign(Iterator first, Iterator last)
+    {
+        count = 0;
+        append(first, last);
+    }
+    void swap(ArenaList& other)
+    {
+        std::swap(items, other.items);
+        std::swap(count, other.count);
+        std::swap(capacityNum, other.capacityNum);
+    }
+private:
+    T* items;
+    std::size_t count;
+    std::size_t capacityNum;
+};
+
+// A list the workers of a pass append to without locks or allocations. Each worker has an appender that
+// fills chunks of CHUNK entries it claims from a shared buffer, gather() packs the filled parts into a
+// plain list once the pass is over. A pass may append up to 'capacity' entries: the buffer has room for
+// those plus one partly filled chunk per appender.
+template <typename T>
+class ChunkedList
+{
+public:
+    static const std::size_t CHUNK = 256;
+
+    class alignas(EngineArena::ALIGNMENT) Appender
+    {
+    public:
+        void push_back(const T& item)
+        {
+            if(position == chunkEnd)
+            {
+                list->claim(*this);
+            }
+            *position++ = item;
+        }
+    private:
+        friend class ChunkedList;
+        T* position;
+        T* chunkEnd;
+        std::size_t chunk;
+        ChunkedList* list;
+    };
+
+    ChunkedList(): entries(nullptr), chunkNum(0), nextChunk(0), fills(nullptr), appenders(nullptr), appenderNum(0) {}
+
+    // arena bytes of a list for 'capacity' entries per pass and 'appenders' workers
+    static std::size_t arenaBytes(std::size_t capacity, std::size_t appenders);
+    void attach(EngineArena& arena, std::size_t capacity, std::size_t appenders);
+    std::size_t size() const { return appenderNum; }
+    Appender& appender(std::size_t slot) { return appenders[slot]; }
+    // moves the entries of the pass to 'list' (which it replaces) and empties this one
+    void gather(ArenaList<T>& list);
+private:
+    static std::size_t chunksFor(std::size_t capacity, std::size_t appenders);
+    void claim(Appender& appender);
+
+    T* entries;
+    std::size_t chunkNum;
+    std::atomic<std::size_t> nextChunk;
+    std::size_t* fills; // entries of each claimed chunk, set when its appender moves on or by gather()
+    Appender* appenders;
+    std::size_t appenderNum;
+};
+
+template <typename T>
+const std::size_t ChunkedList<T>::CHUNK;
+
+template <typename T>
+std::size_t ChunkedList<T>::chunksFor(std::size_t capacity, std::size_t appenders)
+{
+    return (capacity + CHUNK - 1) / CHUNK + appenders;
+}
+
+template <typename T>
+std::size_t ChunkedList<T>::arenaBytes(std::size_t capacity, std::size_t appenders)
+{
+    std::size_t chunks = chunksFor(capacity, appenders);
+    return EngineArena::carvedSize<T>(chunks * CHUNK) + EngineArena::carvedSize<std::size_t>(chunks)
+           + EngineArena::carvedSize<Appender>(appenders);
+}
+
+template <typename T>
+void ChunkedList<T>::attach(EngineArena& arena, std::size_t capacity, std::size_t appenders_)
+{
+    chunkNum = chunksFor(capacity, appenders_);
+    entries = arena.carve<T>(chunkNum * CHUNK);
+    fills = arena.carve<std::size_t>(chunkNum);
+    appenders = arena.carve<Appender>(appenders_);
+    appenderNum = appenders_;
+    for(std::size_t i = 0; i < appenderNum; ++i)
+    {
+        Appender* appender = new (&appenders[i]) Appender();
+        appender->position = appender->chunkEnd = nullptr;
+        appender->chunk = 0;
+        appender->list = this;
+    }
+    nextChunk.store(0);
+}
+
+template <typename T>
+void ChunkedList<T>::claim(Appender& appender)
+{
+    if(appender.chunkEnd)
+    {
+        fills[appender.chunk] = CHUNK;
+    }
+    std::size_t chunk = nextChunk.fetch_add(1);
+    if(chunk >= chunkNum)
+    {
+        throw std::runtime_error("a pass appended more entries than its chunked list holds");
+    }
+    appender.chunk = chunk;
+    appender.position = entries + chunk * CHUNK;
+    appender.chunkEnd = appender.position + CHUNK;
+}
+
+template <typename T>
+void ChunkedList<T>::gather(ArenaList<T>& list)
+{
+    for(std::size_t i = 0; i < appenderNum; ++i)
+    {
+        Appender& appender = appenders[i];
+        if(appender.chunkEnd)
+        {
+            fills[appender.chunk] = appender.position - (entries + appender.chunk * CHUNK);
+            appender.position = appender.chunkEnd = nullptr;
+        }
+    }
+    list.clear();
+    std::size_t claimed = std::min(nextChunk.load(), chunkNum);
+    for(std::size_t chunk = 0; chunk < claimed; ++chunk)
+    {
+        list.append(entries + chunk * CHUNK, entries + chunk * CHUNK + fills[chunk]);
+    }
+    nextChunk.store(0);
+}
+
+#endif
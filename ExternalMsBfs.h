@@ -0,0 +1,604 @@
+#ifndef EXTERNALMSBFS_H
+#define EXTERNALMSBFS_H
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+#include "tbb/parallel_reduce.h"
+
+#include "Types.h"
+#include "GraphFile.h"
+
+// Semi-external MS-BFS for graphs whose adjacency does not fit in memory. The label arrays and the
+// offsets of a binary graph file (see GraphFile.h) are kept in memory, O(nodes) together, while the
+// neighbours section, the edges sorted by source vertex, stays on disk and is streamed level by level
+// in partitions of a fixed number of edges:
+//
+//   top-down   only the partitions that hold adjacency of frontier vertices are read, their vertices
+//              scatter the frontier labels to their neighbours
+//   bottom-up  dense levels (same switching rule as MsBfs) read the partitions that hold adjacency of
+//              vertices some source has not reached yet, those collect the labels of their neighbours
+//
+// A level is closed by a sweep over the labels in memory that reports the new bits to the sink and
+// marks the partitions the next level needs, so a partition is read at most once per level. The reads
+// are large sequential preads: while the workers process one partition, the next one of the level is
+// read into a second buffer and the kernel is asked to read ahead the one after it. Partitions are
+// dropped from the page cache once they are processed, the cache would only compete with the labels
+// for memory. getLevelStats() tells per level how many bytes and partitions were read.
+class AdjacencyStream
+{
+public:
+    // neighbour ids of the partitions read are checked against nodeNum_
+    AdjacencyStream(const std::string& path_, std::size_t sectionOffset_, EdgeIndex edgeNum_, VertexId nodeNum_, std::size_t partitionBytes);
+    ~AdjacencyStream();
+    AdjacencyStream(const AdjacencyStream&) = delete;
+    AdjacencyStream& operator=(const AdjacencyStream&) = delete;
+
+    std::size_t partitionNum() const;
+    EdgeIndex partitionEdges() const;
+    EdgeIndex partitionBegin(std::size_t p) const;
+    EdgeIndex partitionEnd(std::size_t p) const;
+    // partition holding adjacency entry e
+    std::size_t partitionOf(EdgeIndex e) const;
+
+    // Reads the partitions of the plan in its order and calls process(p, edges) for each, where edges
+    // holds the entries [partitionBegin(p), partitionEnd(p)). Returns the bytes read.
+    template <typename Function>
+    std::uint64_t stream(const std::vector<std::size_t>& plan, Function process);
+private:
+    void readPartition(std::size_t p, VertexId* buffer) const;
+    void advise(std::size_t p, int advice) const;
+
+    std::string path;
+    int fd;
+    std::size_t sectionOffset;
+    EdgeIndex edgeNum;
+    VertexId nodeNum;
+    EdgeIndex edgesPerPartition;
+    std::vector<VertexId> buffers[2];
+};
+
+inline AdjacencyStream::AdjacencyStream(const std::string& path_, std::size_t sectionOffset_, EdgeIndex edgeNum_, VertexId nodeNum_, std::size_t partitionBytes):
+    path(path_), fd(-1), sectionOffset(sectionOffset_), edgeNum(edgeNum_), nodeNum(nodeNum_)
+{
+    edgesPerPartition = std::max<EdgeIndex>(1, partitionBytes / sizeof(VertexId));
+    fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        throw std::runtime_error("cannot open " + path);
+    }
+    posix_fadvise(fd, sectionOffset, edgeNum * sizeof(VertexId), POSIX_FADV_SEQUENTIAL);
+    EdgeIndex bufferEdges = std::min(edgesPerPartition, edgeNum);
+    buffers[0].resize(bufferEdges);
+    buffers[1].resize(bufferEdges);
+}
+
+inline AdjacencyStream::~AdjacencyStream()
+{
+    close(fd);
+}
+
+inline std::size_t AdjacencyStream::partitionNum() const
+{
+    return (edgeNum + edgesPerPartition - 1) / edgesPerPartition;
+}
+
+inline EdgeIndex AdjacencyStream::partitionEdges() const
+{
+    return edgesPerPartition;
+}
+
+inline EdgeIndex AdjacencyStream::partitionBegin(std::size_t p) const
+{
+    return p * edgesPerPartition;
+}
+
+inline EdgeIndex AdjacencyStream::partitionEnd(std::size_t p) const
+{
+    return std::min(edgeNum, (p + 1) * edgesPerPartition);
+}
+
+inline std::size_t AdjacencyStream::partitionOf(EdgeIndex e) const
+{
+    return e / edgesPerPartition;
+}
+
+inline void AdjacencyStream::advise(std::size_t p, int advice) const
+{
+    posix_fadvise(fd, sectionOffset + partitionBegin(p) * sizeof(VertexId),
+                  (partitionEnd(p) - partitionBegin(p)) * sizeof(VertexId), advice);
+}
+
+inline void AdjacencyStream::readPartition(std::size_t p, VertexId* buffer) const
+{
+    char* position = reinterpret_cast<char*>(buffer);
+    std::size_t remaining = (partitionEnd(p) - partitionBegin(p)) * sizeof(VertexId);
+    off_t offset = sectionOffset + partitionBegin(p) * sizeof(VertexId);
+    while(remaining > 0)
+    {
+        ssize_t bytes = pread(fd, position, remaining, offset);
+        if(bytes < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(bytes < 0)
+        {
+            throw std::runtime_error("cannot read " + path);
+        }
+        if(bytes == 0)
+        {
+            throw std::runtime_error(path + " is truncated");
+        }
+        position += bytes;
+        offset += bytes;
+        remaining -= bytes;
+    }
+    VertexId* end = buffer + (partitionEnd(p) - partitionBegin(p));
+    if(std::find_if(buffer, end, [this] (VertexId v) {return v >= nodeNum;}) != end)
+    {
+        throw std::runtime_error(path + " has a neighbour id out of range");
+    }
+}
+
+template <typename Function>
+std::uint64_t AdjacencyStream::stream(const std::vector<std::size_t>& plan, Function process)
+{
+    if(plan.empty())
+    {
+        return 0;
+    }
+    std::uint64_t bytes = 0;
+    std::future<void> pending = std::async(std::launch::async, [this, &plan] {readPartition(plan[0], buffers[0].data());});
+    for(std::size_t i = 0; i < plan.size(); ++i)
+    {
+        pending.get(); // passes read errors on
+        if(i + 1 < plan.size())
+        {
+            std::size_t following = plan[i + 1];
+            VertexId* buffer = buffers[(i + 1) % 2].data();
+            pending = std::async(std::launch::async, [this, following, buffer] {readPartition(following, buffer);});
+            if(i + 2 < plan.size())
+            {
+                advise(plan[i + 2], POSIX_FADV_WILLNEED);
+            }
+        }
+        process(plan[i], static_cast<const VertexId*>(buffers[i % 2].data()));
+        advise(plan[i], POSIX_FADV_DONTNEED);
+        bytes += (partitionEnd(plan[i]) - partitionBegin(plan[i])) * sizeof(VertexId);
+    }
+    return bytes;
+}
+
+// one level of one batch of a semi-external run
+struct ExternalLevelStats
+{
+    std::size_t batch;
+    std::size_t level;             // level of the vertices found, the sources are level 0
+    bool bottomUp;
+    std::size_t frontierNodes;     // vertices the level expanded from
+    std::size_t foundNodes;        // vertices that got new bits
+    std::uint64_t bytesRead;
+    std::size_t partitionsRead;    // of partitionNum(), the others were skipped
+    double seconds;
+};
+
+template <unsigned int bitsetSize, typename Sink>
+class ExternalMsBfs
+{
+public:
+    // thresholds of the direction switch, as in MsBfs
+    static const double HYBRID_ALPHA;
+    static const double HYBRID_BETA;
+    static const std::size_t DEFAULT_PARTITION_BYTES;
+    static constexpr std::size_t WORDS = LabelWords<bitsetSize>::count;
+
+    ExternalMsBfs(const std::string& path, std::size_t partitionBytes = DEFAULT_PARTITION_BYTES);
+
+    // sources are dense ids, batches of bitsetSize of them are searched one after another
+    void hybridMsBfs(const std::vector<VertexId>& sources, Sink& sink, double alpha = HYBRID_ALPHA, double beta = HYBRID_BETA);
+
+    VertexId nodeNum() const;
+    EdgeIndex edgeNum() const;
+    EdgeIndex degree(VertexId v) const;
+    // the sources stored in the graph file
+    const std::vector<VertexId>& fileSources() const;
+    // read from the file on every call
+    std::uint64_t originalId(VertexId v) const;
+    std::size_t partitionNum() const;
+    // bytes held in memory: labels, offsets and the two partition buffers
+    std::size_t residentBytes() const;
+    // levels of the last run
+    const std::vector<ExternalLevelStats>& getLevelStats() const;
+private:
+    struct SweepStats
+    {
+        std::size_t frontierNodes;
+        EdgeIndex frontierEdges;
+        EdgeIndex exploredEdges;
+    };
+
+    void initBatch(const std::vector<VertexId>& sources, std::size_t first, std::size_t count);
+    void topDownLevel();
+    void bottomUpLevel();
+    // reports the new bits of 'next', makes them the frontier and marks the partitions of the next level
+    SweepStats finalizeLevel();
+    void markPartitions(VertexId v, std::vector<unsigned char>& flags);
+    std::vector<std::size_t> planOf(std::vector<unsigned char>& flags);
+    bool allSourcesSeen(const ParallelLabel* seenLabel) const;
+
+    std::string path;
+    GraphFileHeader header;
+    std::vector<EdgeIndex> offsets;
+    std::vector<VertexId> sources;
+    AdjacencyStream adjacency;
+    // vertices whose adjacency overlaps each partition
+    std::vector<VertexId> partitionFirstVertex;
+    std::vector<VertexId> partitionEndVertex;
+
+    LabelArray frontier;
+    LabelArray next;
+    LabelArray seen;
+    ParallelLabel allSeenLabel[WORDS];
+    // partitions with adjacency of frontier vertices, and of vertices not seen by every source
+    std::vector<unsigned char> frontierPartitions;
+    std::vector<unsigned char> openPartitions;
+
+    Sink* sink;
+    std::size_t batchNum;
+    std::size_t levelNum;
+    std::vector<ExternalLevelStats> levelStats;
+};
+
+template <unsigned int bitsetSize, typename Sink>
+const double ExternalMsBfs<bitsetSize, Sink>::HYBRID_ALPHA = 14;
+
+template <unsigned int bitsetSize, typename Sink>
+const double ExternalMsBfs<bitsetSize, Sink>::HYBRID_BETA = 24;
+
+template <unsigned int bitsetSize, typename Sink>
+const std::size_t ExternalMsBfs<bitsetSize, Sink>::DEFAULT_PARTITION_BYTES = 64 << 20;
+
+// reads and checks the header of a graph file without mapping it
+inline GraphFileHeader readGraphFileHeader(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if(!in)
+    {
+        throw std::runtime_error("cannot open " + path);
+    }
+    std::size_t fileSize = in.tellg();
+    GraphFileHeader header = {};
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(&header), std::min(sizeof(header), fileSize));
+    checkGraphFileHeader(header, fileSize, path);
+    return header;
+}
+
+// reads count Ts at offset of a file, for the sections a semi-external run keeps in memory
+template <typename T>
+void readFileSection(const std::string& path, std::size_t offset, T* data, std::size_t count)
+{
+    std::ifstream in(path, std::ios::binary);
+    in.seekg(offset);
+    in.read(reinterpret_cast<char*>(data), count * sizeof(T));
+    if(!in)
+    {
+        throw std::runtime_error("cannot read " + path);
+    }
+}
+
+template <unsigned int bitsetSize, typename Sink>
+ExternalMsBfs<bitsetSize, Sink>::ExternalMsBfs(const std::string& path_, std::size_t partitionBytes):
+    path(path_),
+    header(readGraphFileHeader(path_)),
+    offsets(header.nodeNum + 1), sources(header.sourceNum),
+    adjacency(path_, GraphFileLayout(header).neighbours, header.edgeNum, header.nodeNum, partitionBytes),
+    frontier(header.nodeNum * WORDS), next(header.nodeNum * WORDS), seen(header.nodeNum * WORDS),
+    frontierPartitions(adjacency.partitionNum()), openPartitions(adjacency.partitionNum()),
+    sink(nullptr), batchNum(0), levelNum(0)
+{
+    GraphFileLayout layout(header);
+    readFileSection(path, layout.offsets, offsets.data(), offsets.size());
+    checkGraphFileOffsets(offsets.data(), header, path);
+    readFileSection(path, layout.sources, sources.data(), sources.size());
+    checkGraphFileSources(sources, header, path);
+
+    for(std::size_t p = 0; p < adjacency.partitionNum(); ++p)
+    {
+        // the vertex whose adjacency contains the first entry, up to the first one starting past the last
+        partitionFirstVertex.push_back(std::upper_bound(offsets.begin(), offsets.end(), adjacency.partitionBegin(p)) - offsets.begin() - 1);
+        partitionEndVertex.push_back(std::lower_bound(offsets.begin(), offsets.end(), adjacency.partitionEnd(p)) - offsets.begin());
+    }
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void ExternalMsBfs<bitsetSize, Sink>::hybridMsBfs(const std::vector<VertexId>& runSources, Sink& sink_, double alpha, double beta)
+{
+    sink = &sink_;
+    levelStats.clear();
+    for(std::size_t first = 0; first < runSources.size(); first += bitsetSize)
+    {
+        std::size_t count = std::min<std::size_t>(bitsetSize, runSources.size() - first);
+        initBatch(runSources, first, count);
+
+        // a source listed twice is one frontier vertex
+        std::vector<VertexId> distinct(runSources.begin() + first, runSources.begin() + first + count);
+        std::sort(distinct.begin(), distinct.end());
+        distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+        std::size_t frontierNodes = distinct.size();
+        EdgeIndex frontierEdges = 0;
+        EdgeIndex unexploredEdges = header.edgeNum;
+        for(VertexId s: distinct)
+        {
+            frontierEdges += degree(s);
+            markPartitions(s, frontierPartitions);
+            if(allSourcesSeen(&seen[s * WORDS]))
+            {
+                unexploredEdges -= degree(s);
+            }
+        }
+
+        bool bottomUp = false;
+        while(frontierNodes > 0)
+        {
+            if(!bottomUp && frontierEdges > unexploredEdges / alpha)
+            {
+                bottomUp = true;
+            }
+            else if(bottomUp && frontierNodes < header.nodeNum / beta)
+            {
+                bottomUp = false;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            ExternalLevelStats stats = {batchNum, ++levelNum, bottomUp, frontierNodes, 0, 0, 0, 0};
+            std::vector<std::size_t> plan = planOf(bottomUp ? openPartitions : frontierPartitions);
+            stats.partitionsRead = plan.size();
+            if(bottomUp)
+            {
+                stats.bytesRead = adjacency.stream(plan, [&] (std::size_t p, const VertexId* edges) {
+                    tbb::parallel_for(tbb::blocked_range<VertexId>(partitionFirstVertex[p], partitionEndVertex[p]), [&] (const tbb::blocked_range<VertexId>& r) {
+                        for(VertexId v = r.begin(); v != r.end(); ++v)
+                        {
+                            ParallelLabel* seenLabel = &seen[v * WORDS];
+                            if(allSourcesSeen(seenLabel))
+                            {
+                                continue;
+                            }
+                            // the sources that have not reached v yet, less those found in an earlier partition
+                            // of its adjacency; once the neighbours cover them the rest cannot add anything
+                            ParallelLabel* nextLabel = &next[v * WORDS];
+                            ParallelLabel missing[WORDS];
+                            std::copy(allSeenLabel, allSeenLabel + WORDS, missing);
+                            labelAndNot<WORDS>(missing, seenLabel);
+                            labelAndNot<WORDS>(missing, nextLabel);
+                            ParallelLabel label[WORDS];
+                            labelClear<WORDS>(label);
+                            EdgeIndex begin = std::max(offsets[v], adjacency.partitionBegin(p));
+                            EdgeIndex end = std::min(offsets[v + 1], adjacency.partitionEnd(p));
+                            for(EdgeIndex e = begin; e < end; ++e)
+                            {
+                                labelOr<WORDS>(label, &frontier[edges[e - adjacency.partitionBegin(p)] * WORDS]);
+                                if(labelCovers<WORDS>(label, missing))
+                                {
+                                    break;
+                                }
+                            }
+                            labelOr<WORDS>(nextLabel, label);
+                        }
+                    });
+                });
+            }
+            else
+            {
+                stats.bytesRead = adjacency.stream(plan, [&] (std::size_t p, const VertexId* edges) {
+                    tbb::parallel_for(tbb::blocked_range<VertexId>(partitionFirstVertex[p], partitionEndVertex[p]), [&] (const tbb::blocked_range<VertexId>& r) {
+                        for(VertexId v = r.begin(); v != r.end(); ++v)
+                        {
+                            const ParallelLabel* label = &frontier[v * WORDS];
+                            if(labelIsZero<WORDS>(label))
+                            {
+                                continue;
+                            }
+                            EdgeIndex begin = std::max(offsets[v], adjacency.partitionBegin(p));
+                            EdgeIndex end = std::min(offsets[v + 1], adjacency.partitionEnd(p));
+                            for(EdgeIndex e = begin; e < end; ++e)
+                            {
+                                VertexId neighbour = edges[e - adjacency.partitionBegin(p)];
+                                for(std::size_t w = 0; w < WORDS; ++w)
+                                {
+                                    // check before write, as the in-memory scatter does
+                                    ParallelLabel& nextWord = next[neighbour * WORDS + w];
+                                    if(label[w] != 0 && (atomicLoad(nextWord) & label[w]) != label[w])
+                                    {
+                                        atomicFetchOr(nextWord, label[w]);
+                                    }
+                                }
+                            }
+                        }
+                    });
+                });
+            }
+
+            SweepStats sweep = finalizeLevel();
+            sink->endLevel();
+            frontierNodes = sweep.frontierNodes;
+            frontierEdges = sweep.frontierEdges;
+            unexploredEdges -= sweep.exploredEdges;
+
+            stats.foundNodes = sweep.frontierNodes;
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            stats.seconds = elapsed.count();
+            levelStats.push_back(stats);
+        }
+        sink->endBatch();
+    }
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void ExternalMsBfs<bitsetSize, Sink>::initBatch(const std::vector<VertexId>& runSources, std::size_t first, std::size_t count)
+{
+    std::fill(frontier.begin(), frontier.end(), 0);
+    std::fill(next.begin(), next.end(), 0);
+    std::fill(seen.begin(), seen.end(), 0);
+    std::fill(frontierPartitions.begin(), frontierPartitions.end(), 0);
+    std::fill(openPartitions.begin(), openPartitions.end(), 1);
+    labelClear<WORDS>(allSeenLabel);
+    batchNum = first / bitsetSize;
+    levelNum = 0;
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        VertexId s = runSources[first + i];
+        labelSet(&frontier[s * WORDS], i);
+        labelSet(&seen[s * WORDS], i);
+        labelSet(allSeenLabel, i);
+    }
+    sink->beginBatch(first, &runSources[first], count);
+}
+
+template <unsigned int bitsetSize, typename Sink>
+typename ExternalMsBfs<bitsetSize, Sink>::SweepStats ExternalMsBfs<bitsetSize, Sink>::finalizeLevel()
+{
+    std::fill(frontierPartitions.begin(), frontierPartitions.end(), 0);
+    std::fill(openPartitions.begin(), openPartitions.end(), 0);
+    return tbb::parallel_reduce(tbb::blocked_range<VertexId>(0, header.nodeNum), SweepStats{0, 0, 0},
+        [&] (const tbb::blocked_range<VertexId>& r, SweepStats stats) {
+            for(VertexId v = r.begin(); v != r.end(); ++v)
+            {
+                ParallelLabel* nextLabel = &next[v * WORDS];
+                ParallelLabel* seenLabel = &seen[v * WORDS];
+                labelClear<WORDS>(&frontier[v * WORDS]);
+                if(!labelIsZero<WORDS>(nextLabel))
+                {
+                    labelAndNot<WORDS>(nextLabel, seenLabel);
+                    if(!labelIsZero<WORDS>(nextLabel))
+                    {
+                        labelOr<WORDS>(seenLabel, nextLabel);
+                        std::copy(nextLabel, nextLabel + WORDS, &frontier[v * WORDS]);
+                        sink->found(levelNum, v, nextLabel);
+                        ++stats.frontierNodes;
+                        stats.frontierEdges += degree(v);
+                        markPartitions(v, frontierPartitions);
+                        if(allSourcesSeen(seenLabel))
+                        {
+                            stats.exploredEdges += degree(v);
+                        }
+                    }
+                    labelClear<WORDS>(nextLabel);
+                }
+                if(!allSourcesSeen(seenLabel))
+                {
+                    markPartitions(v, openPartitions);
+                }
+            }
+            return stats;
+        },
+        [] (SweepStats a, const SweepStats& b) {
+            a.frontierNodes += b.frontierNodes;
+            a.frontierEdges += b.frontierEdges;
+            a.exploredEdges += b.exploredEdges;
+            return a;
+        });
+}
+
+// Flags are only ever set during a sweep, concurrently by the vertices sharing a partition.
+template <unsigned int bitsetSize, typename Sink>
+void ExternalMsBfs<bitsetSize, Sink>::markPartitions(VertexId v, std::vector<unsigned char>& flags)
+{
+    if(offsets[v] == offsets[v + 1])
+    {
+        return;
+    }
+    std::size_t last = adjacency.partitionOf(offsets[v + 1] - 1);
+    for(std::size_t p = adjacency.partitionOf(offsets[v]); p <= last; ++p)
+    {
+        if(!__atomic_load_n(&flags[p], __ATOMIC_RELAXED))
+        {
+            __atomic_store_n(&flags[p], 1, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+template <unsigned int bitsetSize, typename Sink>
+std::vector<std::size_t> ExternalMsBfs<bitsetSize, Sink>::planOf(std::vector<unsigned char>& flags)
+{
+    std::vector<std::size_t> plan;
+    for(std::size_t p = 0; p < flags.size(); ++p)
+    {
+        if(flags[p])
+        {
+            plan.push_back(p);
+        }
+    }
+    return plan;
+}
+
+template <unsigned int bitsetSize, typename Sink>
+bool ExternalMsBfs<bitsetSize, Sink>::allSourcesSeen(const ParallelLabel* seenLabel) const
+{
+    return labelEquals<WORDS>(seenLabel, allSeenLabel);
+}
+
+template <unsigned int bitsetSize, typename Sink>
+VertexId ExternalMsBfs<bitsetSize, Sink>::nodeNum() const
+{
+    return header.nodeNum;
+}
+
+template <unsigned int bitsetSize, typename Sink>
+EdgeIndex ExternalMsBfs<bitsetSize, Sink>::edgeNum() const
+{
+    return header.edgeNum;
+}
+
+template <unsigned int bitsetSize, typename Sink>
+EdgeIndex ExternalMsBfs<bitsetSize, Sink>::degree(VertexId v) const
+{
+    return offsets[v + 1] - offsets[v];
+}
+
+template <unsigned int bitsetSize, typename Sink>
+const std::vector<VertexId>& ExternalMsBfs<bitsetSize, Sink>::fileSources() const
+{
+    return sources;
+}
+
+template <unsigned int bitsetSize, typename Sink>
+std::uint64_t ExternalMsBfs<bitsetSize, Sink>::originalId(VertexId v) const
+{
+    std::uint64_t id;
+    readFileSection(path, GraphFileLayout(header).originalIds + v * sizeof(std::uint64_t), &id, 1);
+    return id;
+}
+
+template <unsigned int bitsetSize, typename Sink>
+std::size_t ExternalMsBfs<bitsetSize, Sink>::partitionNum() const
+{
+    return adjacency.partitionNum();
+}
+
+template <unsigned int bitsetSize, typename Sink>
+std::size_t ExternalMsBfs<bitsetSize, Sink>::residentBytes() const
+{
+    return 3 * frontier.size() * sizeof(ParallelLabel) + offsets.size() * sizeof(EdgeIndex)
+           + 2 * std::min<EdgeIndex>(adjacency.partitionEdges(), header.edgeNum) * sizeof(VertexId);
+}
+
+template <unsigned int bitsetSize, typename Sink>
+const std::vector<ExternalLevelStats>& ExternalMsBfs<bitsetSize, Sink>::getLevelStats() const
+{
+    return levelStats;
+}
+
+#endif
@@ -0,0 +1,227 @@
+#ifndef GRAPHFILE_H
+#define GRAPHFILE_H
+
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_reduce.h"
+
+#include "CsrGraph.h"
+#include "MappedFile.h"
+#include "VertexOrder.h"
+
+// Binary graph file: the arrays of a CsrGraph as they are in memory, so that a mapped file can be
+// traversed without parsing or copying. Layout (native byte order):
+//
+//   header         GraphFileHeader, 64 bytes
+//   offsets        nodeNum + 1 EdgeIndex
+//   neighbours     edgeNum VertexId
+//   originalIds    nodeNum uint64
+//   denseIds       maxNodeId + 1 VertexId
+//   sources        sourceNum VertexId (dense ids)
+//
+// Every section starts at a multiple of GRAPH_FILE_ALIGNMENT. Files are not trusted: the readers check
+// the header and every id or offset they use before a search does, as the engines index their arrays
+// with these values without further checks.
+
+const char GRAPH_FILE_MAGIC[8] = {'M', 'S', 'B', 'F', 'S', 'C', 'S', 'R'};
+const std::uint32_t GRAPH_FILE_VERSION = 1;
+const std::size_t GRAPH_FILE_ALIGNMENT = 64;
+
+struct GraphFileHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t sourceNum;
+    std::uint64_t nodeNum;
+    std::uint64_t edgeNum;
+    std::uint64_t maxNodeId;
+    std::uint64_t ordering;     // VertexOrdering of the dense ids, so that a reordering is done once
+    std::uint64_t reserved[2];
+};
+
+static_assert(sizeof(GraphFileHeader) == GRAPH_FILE_ALIGNMENT, "the header fills the first section");
+
+inline std::size_t alignGraphSection(std::size_t position)
+{
+    return (position + GRAPH_FILE_ALIGNMENT - 1) / GRAPH_FILE_ALIGNMENT * GRAPH_FILE_ALIGNMENT;
+}
+
+// section offsets of a graph file, the last one is the file size
+struct GraphFileLayout
+{
+    std::size_t offsets;
+    std::size_t neighbours;
+    std::size_t originalIds;
+    std::size_t denseIds;
+    std::size_t sources;
+    std::size_t end;
+
+    GraphFileLayout(const GraphFileHeader& header)
+    {
+        offsets = sizeof(GraphFileHeader);
+        neighbours = alignGraphSection(offsets + (header.nodeNum + 1) * sizeof(EdgeIndex));
+        originalIds = alignGraphSection(neighbours + header.edgeNum * sizeof(VertexId));
+        denseIds = alignGraphSection(originalIds + header.nodeNum * sizeof(std::uint64_t));
+        sources = alignGraphSection(denseIds + (header.maxNodeId + 1) * sizeof(VertexId));
+        end = sources + header.sourceNum * sizeof(VertexId);
+    }
+};
+
+inline void writeGraphSection(std::ofstream& out, std::size_t position, const void* data, std::size_t size)
+{
+    static const char padding[GRAPH_FILE_ALIGNMENT] = {};
+    out.write(padding, position - out.tellp());
+    out.write(static_cast<const char*>(data), size);
+}
+
+// writes g together with the (dense) ids of its named sources
+inline void writeGraphFile(const std::string& path, const CsrGraph& g, const std::vector<VertexId>& sources,
+                           VertexOrdering ordering = VertexOrdering::Original)
+{
+    GraphFileHeader header = {};
+    std::memcpy(header.magic, GRAPH_FILE_MAGIC, sizeof(header.magic));
+    header.version = GRAPH_FILE_VERSION;
+    header.sourceNum = sources.size();
+    header.nodeNum = g.nodeNum();
+    header.edgeNum = g.edgeNum();
+    header.maxNodeId = g.maxNodeId();
+    header.ordering = static_cast<std::uint64_t>(ordering);
+    GraphFileLayout layout(header);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if(!out)
+    {
+        throw std::runtime_error("cannot create " + path);
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeGraphSection(out, layout.offsets, g.offsetData(), (header.nodeNum + 1) * sizeof(EdgeIndex));
+    writeGraphSection(out, layout.neighbours, g.neighbourData(), header.edgeNum * sizeof(VertexId));
+    writeGraphSection(out, layout.originalIds, g.originalIdData(), header.nodeNum * sizeof(std::uint64_t));
+    writeGraphSection(out, layout.denseIds, g.denseIdData(), (header.maxNodeId + 1) * sizeof(VertexId));
+    writeGraphSection(out, layout.sources, sources.data(), header.sourceNum * sizeof(VertexId));
+    if(!out)
+    {
+        throw std::runtime_error("cannot write " + path);
+    }
+}
+
+// true if the file starts like a graph file, so that callers can fall back to the text formats
+inline bool isGraphFile(const std::string& path)
+{
+    char magic[sizeof(GRAPH_FILE_MAGIC)] = {};
+    std::ifstream in(path, std::ios::binary);
+    in.read(magic, sizeof(magic));
+    return in && std::memcmp(magic, GRAPH_FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+// Checks the header read from the first bytes of a graph file of fileSize bytes and returns its layout.
+inline GraphFileLayout checkGraphFileHeader(const GraphFileHeader& header, std::size_t fileSize, const std::string& path)
+{
+    if(fileSize < sizeof(GraphFileHeader))
+    {
+        throw std::runtime_error(path + " is not a graph file");
+    }
+    if(std::memcmp(header.magic, GRAPH_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != GRAPH_FILE_VERSION)
+    {
+        throw std::runtime_error(path + " is not a graph file of version " + std::to_string(GRAPH_FILE_VERSION));
+    }
+    // every section has to fit in the file on its own, which also keeps the layout from overflowing
+    if(header.nodeNum >= INVALID_VERTEX || header.ordering > static_cast<std::uint64_t>(VertexOrdering::HubCluster)
+       || header.nodeNum >= fileSize / sizeof(EdgeIndex) || header.edgeNum > fileSize / sizeof(VertexId)
+       || header.maxNodeId >= fileSize / sizeof(VertexId) || header.sourceNum > fileSize / sizeof(VertexId))
+    {
+        throw std::runtime_error(path + " has a corrupt header");
+    }
+    GraphFileLayout layout(header);
+    if(fileSize < layout.end)
+    {
+        throw std::runtime_error(path + " is truncated");
+    }
+    return layout;
+}
+
+// true if ids[0, count) are all below limit, or INVALID_VERTEX where unset ids are allowed
+inline bool graphFileIdsInRange(const VertexId* ids, std::size_t count, std::uint64_t limit, bool unset = false)
+{
+    return tbb::parallel_reduce(tbb::blocked_range<std::size_t>(0, count), true,
+        [&] (const tbb::blocked_range<std::size_t>& r, bool valid) {
+            for(std::size_t i = r.begin(); valid && i != r.end(); ++i)
+            {
+                valid = ids[i] < limit || (unset && ids[i] == INVALID_VERTEX);
+            }
+            return valid;
+        },
+        [] (bool a, bool b) {return a && b;});
+}
+
+// offsets have to start at 0, grow monotonically and end at edgeNum
+inline void checkGraphFileOffsets(const EdgeIndex* offsets, const GraphFileHeader& header, const std::string& path)
+{
+    bool valid = offsets[0] == 0 && offsets[header.nodeNum] == header.edgeNum
+        && tbb::parallel_reduce(tbb::blocked_range<std::size_t>(0, header.nodeNum), true,
+            [&] (const tbb::blocked_range<std::size_t>& r, bool monotone) {
+                for(std::size_t v = r.begin(); monotone && v != r.end(); ++v)
+                {
+                    monotone = offsets[v] <= offsets[v + 1];
+                }
+                return monotone;
+            },
+            [] (bool a, bool b) {return a && b;});
+    if(!valid)
+    {
+        throw std::runtime_error(path + " has corrupt offsets");
+    }
+}
+
+inline void checkGraphFileSources(const std::vector<VertexId>& sources, const GraphFileHeader& header, const std::string& path)
+{
+    for(VertexId s: sources)
+    {
+        if(s >= header.nodeNum)
+        {
+            throw std::runtime_error(path + " names source " + std::to_string(s) + " of " + std::to_string(header.nodeNum) + " vertices");
+        }
+    }
+}
+
+// Maps a graph file, the returned graph reads its arrays straight from the mapping.
+inline CsrGraph mapGraphFile(const std::string& path, std::vector<VertexId>& sources, VertexOrdering* ordering = nullptr)
+{
+    std::shared_ptr<const MappedFile> file = std::make_shared<MappedFile>(path);
+    GraphFileHeader header = {};
+    if(file->size() >= sizeof(header))
+    {
+        std::memcpy(&header, file->data(), sizeof(header));
+    }
+    GraphFileLayout layout = checkGraphFileHeader(header, file->size(), path);
+
+    const char* data = file->data();
+    checkGraphFileOffsets(reinterpret_cast<const EdgeIndex*>(data + layout.offsets), header, path);
+    if(!graphFileIdsInRange(reinterpret_cast<const VertexId*>(data + layout.neighbours), header.edgeNum, header.nodeNum))
+    {
+        throw std::runtime_error(path + " has a neighbour id out of range");
+    }
+    if(!graphFileIdsInRange(reinterpret_cast<const VertexId*>(data + layout.denseIds), header.maxNodeId + 1, header.nodeNum, true))
+    {
+        throw std::runtime_error(path + " has a dense id out of range");
+    }
+    const VertexId* fileSources = reinterpret_cast<const VertexId*>(data + layout.sources);
+    sources.assign(fileSources, fileSources + header.sourceNum);
+    checkGraphFileSources(sources, header, path);
+    if(ordering)
+    {
+        *ordering = static_cast<VertexOrdering>(header.ordering);
+    }
+    return CsrGraph(file, header.nodeNum, header.edgeNum, header.maxNodeId,
+                    reinterpret_cast<const EdgeIndex*>(data + layout.offsets),
+                    reinterpret_cast<const VertexId*>(data + layout.neighbours),
+                    reinterpret_cast<const std::uint64_t*>(data + layout.originalIds),
+                    reinterpret_cast<const VertexId*>(data + layout.denseIds));
+}
+
+#endif
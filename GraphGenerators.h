@@ -0,0 +1,257 @@
+#ifndef GRAPHGENERATORS_H
+#define GRAPHGENERATORS_H
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
+#include "Types.h"
+#include "CsrGraph.h"
+#include "EdgeListReader.h"
+
+// Synthetic graphs for benchmarking, 2^scale vertices each:
+//
+//   rmat   Graph500 Kronecker / R-MAT, edgeFactor * 2^scale edges, every edge picks one quadrant of the
+//          adjacency matrix per bit with probabilities a, b, c, 1 - a - b - c; the vertex ids are
+//          scrambled afterwards so that the hubs are not the smallest ids
+//   er     Erdos-Renyi G(n, m), edgeFactor * 2^scale edges between uniformly drawn endpoints
+//   grid   2D grid of 2^(scale / 2) rows, every vertex linked to its right and lower neighbour
+//
+// Edges are drawn in fixed blocks with one generator per block, so a graph only depends on its
+// options and not on the number of workers. Self-loops and parallel edges are dropped, isolated
+// vertices are kept. Vertex i keeps i as its original id.
+
+enum class GraphGenerator : std::uint32_t
+{
+    Rmat = 0,
+    ErdosRenyi,
+    Grid
+};
+
+inline const char* graphGeneratorName(GraphGenerator generator)
+{
+    switch(generator)
+    {
+        case GraphGenerator::Rmat: return "rmat";
+        case GraphGenerator::ErdosRenyi: return "er";
+        case GraphGenerator::Grid: return "grid";
+    }
+    return "unknown";
+}
+
+inline GraphGenerator parseGraphGenerator(const std::string& name)
+{
+    for(GraphGenerator generator: {GraphGenerator::Rmat, GraphGenerator::ErdosRenyi, GraphGenerator::Grid})
+    {
+        if(name == graphGeneratorName(generator))
+        {
+            return generator;
+        }
+    }
+    if(name == "kronecker")
+    {
+        return GraphGenerator::Rmat;
+    }
+    throw std::runtime_error("unknown graph generator " + name + " (rmat, er or grid)");
+}
+
+struct GeneratorOptions
+{
+    GraphGenerator generator = GraphGenerator::Rmat;
+    unsigned int scale = 16;
+    unsigned int edgeFactor = 16;
+    std::uint64_t seed = 1;
+    // Graph500 initiator probabilities
+    double a = 0.57;
+    double b = 0.19;
+    double c = 0.19;
+};
+
+using GeneratedEdge = std::pair<VertexId, VertexId>;
+
+// edges per random generator
+const std::size_t GENERATOR_BLOCK_SIZE = 1 << 16;
+
+// a generator for every block, seeded from the graph seed and the block number
+inline std::mt19937_64 blockGenerator(std::uint64_t seed, std::size_t block)
+{
+    std::seed_seq sequence{std::uint32_t(seed), std::uint32_t(seed >> 32), std::uint32_t(block), std::uint32_t(block >> 32)};
+    return std::mt19937_64(sequence);
+}
+
+// fills edges[i] = draw(generator) for every i, block by block on the workers
+template <typename Draw>
+void drawEdges(std::vector<GeneratedEdge>& edges, std::uint64_t seed, Draw draw)
+{
+    std::size_t blockNumber = (edges.size() + GENERATOR_BLOCK_SIZE - 1) / GENERATOR_BLOCK_SIZE;
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, blockNumber, 1), [&] (const tbb::blocked_range<std::size_t>& r) {
+        for(std::size_t block = r.begin(); block != r.end(); ++block)
+        {
+            std::mt19937_64 generator = blockGenerator(seed, block);
+            std::size_t end = std::min(edges.size(), (block + 1) * GENERATOR_BLOCK_SIZE);
+            for(std::size_t i = block * GENERATOR_BLOCK_SIZE; i < end; ++i)
+            {
+                edges[i] = draw(generator);
+            }
+        }
+    });
+}
+
+inline std::vector<GeneratedEdge> rmatEdges(const GeneratorOptions& options)
+{
+    VertexId nodeNumber = VertexId(1) << options.scale;
+    std::vector<GeneratedEdge> edges(EdgeIndex(options.edgeFactor) << options.scale);
+    double ab = options.a + options.b;
+    double abc = ab + options.c;
+    drawEdges(edges, options.seed, [&] (std::mt19937_64& generator) {
+        std::uniform_real_distribution<double> uniform(0, 1);
+        VertexId u = 0, v = 0;
+        for(unsigned int bit = 0; bit < options.scale; ++bit)
+        {
+            double p = uniform(generator);
+            u = (u << 1) | (p >= ab ? 1 : 0);
+            v = (v << 1) | ((p >= options.a && p < ab) || p >= abc ? 1 : 0);
+        }
+        return GeneratedEdge(u, v);
+    });
+
+    // scramble the ids
+    std::vector<VertexId> permutation(nodeNumber);
+    std::iota(permutation.begin(), permutation.end(), 0);
+    std::mt19937_64 generator = blockGenerator(options.seed, ~std::size_t(0));
+    std::shuffle(permutation.begin(), permutation.end(), generator);
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, edges.size()), [&] (const tbb::blocked_range<std::size_t>& r) {
+        for(std::size_t i = r.begin(); i != r.end(); ++i)
+        {
+            edges[i] = GeneratedEdge(permutation[edges[i].first], permutation[edges[i].second]);
+        }
+    });
+    return edges;
+}
+
+inline std::vector<GeneratedEdge> erdosRenyiEdges(const GeneratorOptions& options)
+{
+    VertexId nodeNumber = VertexId(1) << options.scale;
+    std::vector<GeneratedEdge> edges(EdgeIndex(options.edgeFactor) << options.scale);
+    drawEdges(edges, options.seed, [&] (std::mt19937_64& generator) {
+        std::uniform_int_distribution<VertexId> uniform(0, nodeNumber - 1);
+        VertexId u = uniform(generator);
+        return GeneratedEdge(u, uniform(generator));
+    });
+    return edges;
+}
+
+inline std::vector<GeneratedEdge> gridEdges(const GeneratorOptions& options)
+{
+    VertexId rows = VertexId(1) << (options.scale / 2);
+    VertexId columns = VertexId(1) << (options.scale - options.scale / 2);
+    std::vector<GeneratedEdge> edges;
+    edges.reserve(2 * EdgeIndex(rows) * columns);
+    for(VertexId row = 0; row < rows; ++row)
+    {
+        for(VertexId column = 0; column < columns; ++column)
+        {
+            VertexId v = row * columns + column;
+            if(column + 1 < columns)
+            {
+                edges.emplace_back(v, v + 1);
+            }
+            if(row + 1 < rows)
+            {
+                edges.emplace_back(v, v + columns);
+            }
+        }
+    }
+    return edges;
+}
+
+// Undirected snapshot of vertices [0, nodeNumber) and the given edges, both directions are stored.
+inline CsrGraph buildGraph(VertexId nodeNumber, const std::vector<GeneratedEdge>& edges)
+{
+    // degrees, then the counters become the next free slot of each vertex
+    std::vector<std::uint64_t> counters(nodeNumber, 0);
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, edges.size()), [&] (const tbb::blocked_range<std::size_t>& r) {
+        for(std::size_t i = r.begin(); i != r.end(); ++i)
+        {
+            if(edges[i].first != edges[i].second)
+            {
+                atomicFetchAdd(counters[edges[i].first], 1);
+                atomicFetchAdd(counters[edges[i].second], 1);
+            }
+        }
+    });
+    std::vector<EdgeIndex> offsets(nodeNumber + 1, 0);
+    for(VertexId v = 0; v < nodeNumber; ++v)
+    {
+        offsets[v + 1] = offsets[v] + counters[v];
+        counters[v] = offsets[v];
+    }
+
+    std::vector<VertexId> neighbours(offsets.back());
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, edges.size()), [&] (const tbb::blocked_range<std::size_t>& r) {
+        for(std::size_t i = r.begin(); i != r.end(); ++i)
+        {
+            VertexId u = edges[i].first, v = edges[i].second;
+            if(u != v)
+            {
+                neighbours[atomicFetchAdd(counters[u], 1)] = v;
+                neighbours[atomicFetchAdd(counters[v], 1)] = u;
+            }
+        }
+    });
+    std::vector<std::uint64_t>().swap(counters);
+    removeDuplicateNeighbours(offsets, neighbours);
+
+    std::vector<std::uint64_t> originalIds(nodeNumber);
+    std::iota(originalIds.begin(), originalIds.end(), 0);
+    std::vector<VertexId> denseIds(nodeNumber);
+    std::iota(denseIds.begin(), denseIds.end(), 0);
+    return CsrGraph(std::move(offsets), std::move(neighbours), std::move(originalIds), std::move(denseIds), nodeNumber - 1);
+}
+
+inline CsrGraph generateGraph(const GeneratorOptions& options)
+{
+    if(options.scale == 0 || options.scale > 31)
+    {
+        throw std::runtime_error("graph scale must be between 1 and 31");
+    }
+    VertexId nodeNumber = VertexId(1) << options.scale;
+    switch(options.generator)
+    {
+        case GraphGenerator::Rmat: return buildGraph(nodeNumber, rmatEdges(options));
+        case GraphGenerator::ErdosRenyi: return buildGraph(nodeNumber, erdosRenyiEdges(options));
+        case GraphGenerator::Grid: return buildGraph(nodeNumber, gridEdges(options));
+    }
+    throw std::runtime_error("unknown graph generator");
+}
+
+// Graph500 style search keys: distinct vertices drawn at random among those with at least one edge.
+// Returns fewer than count if the graph has fewer such vertices.
+inline std::vector<VertexId> sampleSources(const CsrGraph& g, std::size_t count, std::uint64_t seed)
+{
+    std::vector<VertexId> candidates;
+    for(VertexId v = 0; v < g.nodeNum(); ++v)
+    {
+        if(g.degree(v) > 0)
+        {
+            candidates.push_back(v);
+        }
+    }
+    std::mt19937_64 generator = blockGenerator(seed, 0);
+    count = std::min(count, candidates.size());
+    // partial Fisher-Yates, the first count candidates are the sample
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        std::uniform_int_distribution<std::size_t> uniform(i, candidates.size() - 1);
+        std::swap(candidates[i], candidates[uniform(generator)]);
+    }
+    candidates.resize(count);
+    return candidates;
+}
+
+#endif
@@ -0,0 +1,445 @@
+#ifndef INCREMENTALMSBFS_H
+#define INCREMENTALMSBFS_H
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Types.h"
+#include "CsrGraph.h"
+#include "MsPbfs.h"
+#include "GraphGenerators.h"
+
+// Keeps the result of one batch of MS-BFS (the distance of every vertex from each of up to bitsetSize
+// sources) up to date while edges are inserted and deleted, instead of rerunning the traversal after
+// every change.
+//
+// The graph is the snapshot the batch ran on plus a delta of inserted edges and a set of deleted ones.
+// An insertion (u, v) can only shorten distances: every source with d(u) + 1 < d(v) (or the other way
+// round) starts a top-down wave at v on level d(u) + 1. The waves of a whole update are run together in
+// level order, the label of a vertex on a level is the set of sources whose distance just dropped to
+// that level, and a wave stops where it does not improve anything, so the work is proportional to the
+// part of the graph whose distances changed.
+// A deletion (u, v) is local if no shortest path needs it: for every source with d(v) = d(u) + 1, v
+// has another neighbour on level d(u) (and the same the other way round). Otherwise the update falls
+// back to a full run on a merged snapshot, which also folds the delta into the base again.
+//
+// Every update reports the adjacency entries it scanned against those a full top-down run scans (as
+// measured by the last full run), so callers see what the incremental path saved. Vertices are dense
+// ids of the snapshot, edges between new vertices need a new snapshot and a new instance.
+
+using IncrementalEdge = std::pair<VertexId, VertexId>;
+
+struct UpdateStats
+{
+    std::size_t edges;                  // edges of the update
+    std::uint64_t changedDistances;     // (vertex, source) pairs whose distance changed
+    std::uint64_t scannedEdges;         // adjacency entries the update scanned
+    std::uint64_t fullRunEdges;         // adjacency entries a full top-down run scans
+    bool rerun;                         // the update fell back to a full run
+    double seconds;
+
+    // adjacency entries not scanned compared to a full run, 0 for a rerun
+    std::uint64_t savedEdges() const
+    {
+        return rerun || scannedEdges > fullRunEdges ? 0 : fullRunEdges - scannedEdges;
+    }
+};
+
+// totals over the updates of an instance
+struct IncrementalStats
+{
+    std::size_t updates;
+    std::size_t reruns;
+    std::uint64_t scannedEdges;
+    std::uint64_t savedEdges;
+};
+
+template <unsigned int bitsetSize>
+class IncrementalMsBfs
+{
+public:
+    using Distance = std::uint16_t;
+    static const Distance UNREACHED = std::numeric_limits<Distance>::max();
+
+    // runs the sources (at most bitsetSize) on g, which has to outlive the instance
+    IncrementalMsBfs(const CsrGraph& g, const std::vector<VertexId>& sources);
+
+    UpdateStats insertEdges(const std::vector<IncrementalEdge>& edges);
+    UpdateStats deleteEdges(const std::vector<IncrementalEdge>& edges);
+
+    Distance distance(std::size_t source, VertexId v) const;
+    std::size_t sourceNum() const;
+    const IncrementalStats& getStats() const;
+    // the current graph as a new snapshot (the base with the delta applied)
+    CsrGraph snapshot() const;
+private:
+    // records the distances of a full run, by vertex and then source
+    class DistanceStateSink
+    {
+    public:
+        DistanceStateSink(std::vector<Distance>& distances_): distances(distances_), firstSource(0) {}
+        void beginBatch(std::size_t first, const VertexId* sources, std::size_t count)
+        {
+            firstSource = first;
+            for(std::size_t i = 0; i < count; ++i)
+            {
+                distances[sources[i] * bitsetSize + first + i] = 0;
+            }
+        }
+        void found(std::size_t level, VertexId v, const ParallelLabel* label)
+        {
+            labelForEachBit<WORDS>(label, [&] (std::size_t i) {
+                distances[v * bitsetSize + firstSource + i] = level;
+            });
+        }
+        void endLevel() {}
+        void endBatch() {}
+    private:
+        std::vector<Distance>& distances;
+        std::size_t firstSource;
+    };
+
+    static constexpr std::size_t WORDS = LabelWords<bitsetSize>::count;
+
+    static std::uint64_t edgeKey(VertexId u, VertexId v);
+    bool isDeleted(VertexId u, VertexId v) const;
+    bool hasEdge(VertexId u, VertexId v) const;
+    bool removeEdge(VertexId u, VertexId v);
+    template <typename Function>
+    std::uint64_t forEachNeighbour(VertexId v, Function f) const;
+    void fullRun();
+    void improve(VertexId v, std::size_t source, std::size_t level);
+    bool hasOtherParent(VertexId v, VertexId removed, std::size_t source) const;
+    void finishUpdate(UpdateStats& stats, std::chrono::steady_clock::time_point start);
+
+    const CsrGraph* graph;            // the base snapshot, the caller's or 'rebuilt'
+    std::unique_ptr<CsrGraph> rebuilt;
+    std::unordered_map<VertexId, std::vector<VertexId>> inserted;
+    std::unordered_set<std::uint64_t> deleted;
+    std::vector<VertexId> sources;
+    std::vector<Distance> distances;
+    std::uint64_t fullRunEdges;
+    IncrementalStats totals;
+    // the waves of the current update: vertices by level, and the sources of each vertex not propagated yet
+    std::vector<std::vector<VertexId>> waves;
+    std::vector<ParallelLabel> pending;
+    std::uint64_t changed;
+};
+
+template <unsigned int bitsetSize>
+const typename IncrementalMsBfs<bitsetSize>::Distance IncrementalMsBfs<bitsetSize>::UNREACHED;
+
+template <unsigned int bitsetSize>
+IncrementalMsBfs<bitsetSize>::IncrementalMsBfs(const CsrGraph& g, const std::vector<VertexId>& sources_):
+    graph(&g), sources(sources_), fullRunEdges(0), totals{0, 0, 0, 0}, pending(g.nodeNum() * WORDS, 0), changed(0)
+{
+    if(sources.size() > bitsetSize)
+    {
+        throw std::runtime_error("an incremental MS-BFS keeps a single batch of at most " + std::to_string(bitsetSize) + " sources");
+    }
+    fullRun();
+}
+
+template <unsigned int bitsetSize>
+void IncrementalMsBfs<bitsetSize>::fullRun()
+{
+    distances.assign(std::size_t(graph->nodeNum()) * bitsetSize, UNREACHED);
+    DistanceStateSink sink(distances);
+    MsBfs<bitsetSize, DistanceStateSink> engine(*graph);
+    engine.topDownMsPbfs(sources, sink);
+    fullRunEdges = engine.getScatterStats().scannedEdges;
+}
+
+template <unsigned int bitsetSize>
+std::uint64_t IncrementalMsBfs<bitsetSize>::edgeKey(VertexId u, VertexId v)
+{
+    return std::uint64_t(std::min(u, v)) << 32 | std::max(u, v);
+}
+
+template <unsigned int bitsetSize>
+bool IncrementalMsBfs<bitsetSize>::isDeleted(VertexId u, VertexId v) const
+{
+    return !deleted.empty() && deleted.count(edgeKey(u, v)) > 0;
+}
+
+// true if the edge is in the current graph, in the base and not deleted or inserted
+template <unsigned int bitsetSize>
+bool IncrementalMsBfs<bitsetSize>::hasEdge(VertexId u, VertexId v) const
+{
+    auto it = inserted.find(u);
+    if(it != inserted.end() && std::find(it->second.begin(), it->second.end(), v) != it->second.end())
+    {
+        return true;
+    }
+    return !isDeleted(u, v) && std::find(graph->neighboursBegin(u), graph->neighboursEnd(u), v) != graph->neighboursEnd(u);
+}
+
+// takes an edge out of the current graph, returns false if it is not in there
+template <unsigned int bitsetSize>
+bool IncrementalMsBfs<bitsetSize>::removeEdge(VertexId u, VertexId v)
+{
+    auto dropInserted = [&] (VertexId from, VertexId to) {
+        auto it = inserted.find(from);
+        if(it == inserted.end())
+        {
+            return false;
+        }
+        auto position = std::find(it->second.begin(), it->second.end(), to);
+        if(position == it->second.end())
+        {
+            return false;
+        }
+        it->second.erase(position);
+        return true;
+    };
+    if(dropInserted(u, v))
+    {
+        dropInserted(v, u);
+        return true;
+    }
+    if(isDeleted(u, v) || std::find(graph->neighboursBegin(u), graph->neighboursEnd(u), v) == graph->neighboursEnd(u))
+    {
+        return false;
+    }
+    deleted.insert(edgeKey(u, v));
+    return true;
+}
+
+// calls f(w) for every current neighbour w of v, returns the number of adjacency entries scanned
+template <unsigned int bitsetSize>
+template <typename Function>
+std::uint64_t IncrementalMsBfs<bitsetSize>::forEachNeighbour(VertexId v, Function f) const
+{
+    for(const VertexId* e = graph->neighboursBegin(v); e != graph->neighboursEnd(v); ++e)
+    {
+        if(!isDeleted(v, *e))
+        {
+            f(*e);
+        }
+    }
+    std::uint64_t scanned = graph->degree(v);
+    auto it = inserted.find(v);
+    if(it != inserted.end())
+    {
+        for(VertexId w: it->second)
+        {
+            if(!isDeleted(v, w))
+            {
+                f(w);
+            }
+        }
+        scanned += it->second.size();
+    }
+    return scanned;
+}
+
+// lowers the distance of v from a source to 'level' and queues v for the wave of that level
+template <unsigned int bitsetSize>
+void IncrementalMsBfs<bitsetSize>::improve(VertexId v, std::size_t source, std::size_t level)
+{
+    distances[v * bitsetSize + source] = level;
+    ++changed;
+    ParallelLabel* label = &pending[v * WORDS];
+    if(labelIsZero<WORDS>(label) || waves.size() <= level || waves[level].empty() || waves[level].back() != v)
+    {
+        if(waves.size() <= level)
+        {
+            waves.resize(level + 1);
+        }
+        waves[level].push_back(v);
+    }
+    labelSet(label, source);
+}
+
+template <unsigned int bitsetSize>
+UpdateStats IncrementalMsBfs<bitsetSize>::insertEdges(const std::vector<IncrementalEdge>& edges)
+{
+    auto start = std::chrono::steady_clock::now();
+    UpdateStats stats{edges.size(), 0, 0, fullRunEdges, false, 0};
+    changed = 0;
+
+    // the seeds: both ends of every new edge
+    for(const IncrementalEdge& edge: edges)
+    {
+        // an edge that is there already changes nothing, and a second copy would survive its deletion
+        if(edge.first == edge.second || hasEdge(edge.first, edge.second))
+        {
+            continue;
+        }
+        if(!deleted.erase(edgeKey(edge.first, edge.second)))
+        {
+            inserted[edge.first].push_back(edge.second);
+            inserted[edge.second].push_back(edge.first);
+        }
+        for(int direction = 0; direction < 2; ++direction)
+        {
+            VertexId u = direction == 0 ? edge.first : edge.second;
+            VertexId v = direction == 0 ? edge.second : edge.first;
+            for(std::size_t i = 0; i < sources.size(); ++i)
+            {
+                Distance du = distances[u * bitsetSize + i];
+                if(du != UNREACHED && std::size_t(du) + 1 < distances[v * bitsetSize + i])
+                {
+                    improve(v, i, du + 1);
+                }
+            }
+        }
+    }
+
+    // the waves, level by level; a vertex only passes on the sources whose distance dropped to this level
+    ParallelLabel label[WORDS];
+    for(std::size_t level = 0; level < waves.size(); ++level)
+    {
+        for(std::size_t j = 0; j < waves[level].size(); ++j)
+        {
+            VertexId v = waves[level][j];
+            labelClear<WORDS>(label);
+            ParallelLabel* vertexPending = &pending[v * WORDS];
+            labelForEachBit<WORDS>(vertexPending, [&] (std::size_t i) {
+                if(distances[v * bitsetSize + i] == level)
+                {
+                    labelSet(label, i);
+                }
+            });
+            if(labelIsZero<WORDS>(label))
+            {
+                continue;
+            }
+            labelAndNot<WORDS>(vertexPending, label);
+            stats.scannedEdges += forEachNeighbour(v, [&] (VertexId w) {
+                labelForEachBit<WORDS>(label, [&] (std::size_t i) {
+                    if(std::size_t(distances[w * bitsetSize + i]) > level + 1)
+                    {
+                        improve(w, i, level + 1);
+                    }
+                });
+            });
+        }
+        std::vector<VertexId>().swap(waves[level]);
+    }
+    waves.clear();
+    stats.changedDistances = changed;
+    finishUpdate(stats, start);
+    return stats;
+}
+
+// true if v keeps a neighbour other than 'removed' one level closer to the source
+template <unsigned int bitsetSize>
+bool IncrementalMsBfs<bitsetSize>::hasOtherParent(VertexId v, VertexId removed, std::size_t source) const
+{
+    Distance parentLevel = distances[v * bitsetSize + source] - 1;
+    bool found = false;
+    forEachNeighbour(v, [&] (VertexId w) {
+        found = found || (w != removed && distances[w * bitsetSize + source] == parentLevel);
+    });
+    return found;
+}
+
+template <unsigned int bitsetSize>
+UpdateStats IncrementalMsBfs<bitsetSize>::deleteEdges(const std::vector<IncrementalEdge>& edges)
+{
+    auto start = std::chrono::steady_clock::now();
+    UpdateStats stats{edges.size(), 0, 0, fullRunEdges, false, 0};
+
+    // a deletion is local unless it takes away the only parent of an endpoint on some source's BFS tree
+    bool local = true;
+    for(const IncrementalEdge& edge: edges)
+    {
+        if(edge.first == edge.second || !removeEdge(edge.first, edge.second))
+        {
+            continue;
+        }
+        for(int direction = 0; direction < 2 && local; ++direction)
+        {
+            VertexId u = direction == 0 ? edge.first : edge.second;
+            VertexId v = direction == 0 ? edge.second : edge.first;
+            for(std::size_t i = 0; i < sources.size() && local; ++i)
+            {
+                Distance du = distances[u * bitsetSize + i];
+                if(du != UNREACHED && std::size_t(du) + 1 == distances[v * bitsetSize + i])
+                {
+                    stats.scannedEdges += graph->degree(v);
+                    local = hasOtherParent(v, u, i);
+                }
+            }
+        }
+    }
+    if(!local)
+    {
+        // the deletions of this update are all checked against the old distances, so the check stops at the
+        // first edge that needs the rerun and the remaining ones are simply applied by it
+        std::vector<Distance> before(distances);
+        rebuilt.reset(new CsrGraph(snapshot()));
+        graph = rebuilt.get();
+        inserted.clear();
+        deleted.clear();
+        fullRun();
+        for(std::size_t i = 0; i < distances.size(); ++i)
+        {
+            stats.changedDistances += distances[i] != before[i];
+        }
+        stats.rerun = true;
+        stats.scannedEdges += fullRunEdges;
+        stats.fullRunEdges = fullRunEdges;
+    }
+    finishUpdate(stats, start);
+    return stats;
+}
+
+template <unsigned int bitsetSize>
+void IncrementalMsBfs<bitsetSize>::finishUpdate(UpdateStats& stats, std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    stats.seconds = elapsed.count();
+    ++totals.updates;
+    totals.reruns += stats.rerun;
+    totals.scannedEdges += stats.scannedEdges;
+    totals.savedEdges += stats.savedEdges();
+}
+
+template <unsigned int bitsetSize>
+CsrGraph IncrementalMsBfs<bitsetSize>::snapshot() const
+{
+    std::vector<GeneratedEdge> edges;
+    edges.reserve(graph->edgeNum() / 2);
+    for(VertexId v = 0; v < graph->nodeNum(); ++v)
+    {
+        forEachNeighbour(v, [&] (VertexId w) {
+            if(v < w)
+            {
+                edges.emplace_back(v, w);
+            }
+        });
+    }
+    CsrGraph merged = buildGraph(graph->nodeNum(), edges);
+    // keep the original ids of the base
+    std::vector<EdgeIndex> offsets(merged.offsetData(), merged.offsetData() + merged.nodeNum() + 1);
+    std::vector<VertexId> neighbours(merged.neighbourData(), merged.neighbourData() + merged.edgeNum());
+    std::vector<std::uint64_t> originalIds(graph->originalIdData(), graph->originalIdData() + graph->nodeNum());
+    std::vector<VertexId> denseIds(graph->denseIdData(), graph->denseIdData() + graph->maxNodeId() + 1);
+    return CsrGraph(std::move(offsets), std::move(neighbours), std::move(originalIds), std::move(denseIds), graph->maxNodeId());
+}
+
+template <unsigned int bitsetSize>
+typename IncrementalMsBfs<bitsetSize>::Distance IncrementalMsBfs<bitsetSize>::distance(std::size_t source, VertexId v) const
+{
+    return distances[v * bitsetSize + source];
+}
+
+template <unsigned int bitsetSize>
+std::size_t IncrementalMsBfs<bitsetSize>::sourceNum() const
+{
+    return sources.size();
+}
+
+template <unsigned int bitsetSize>
+const IncrementalStats& IncrementalMsBfs<bitsetSize>::getStats() const
+{
+    return totals;
+}
+
+#endif
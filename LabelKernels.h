@@ -0,0 +1,356 @@
+#ifndef LABELKERNELS_H
+#define LABELKERNELS_H
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include <immintrin.h>
+
+// Operations on multi-word parallel labels.
+// A label of bitsetSize bits is stored in LabelWords<bitsetSize>::count consecutive words,
+// bit i of the label is bit (i % LABEL_WORD_BITS) of word (i / LABEL_WORD_BITS).
+// Labels of 256 bits and more are handled by AVX2 / AVX-512 kernels, picked at runtime from
+// what the CPU supports. Narrower labels always use the scalar loops, they are a word or two wide.
+
+using ParallelLabel = std::uint64_t;
+
+const unsigned int LABEL_WORD_BITS = 64;
+
+template < unsigned int bitsetSize >
+struct LabelWords
+{
+	static constexpr std::size_t count = (bitsetSize + LABEL_WORD_BITS - 1) / LABEL_WORD_BITS;
+	// the used bits of the last word, all words before it are used completely
+	static constexpr ParallelLabel lastWordMask = bitsetSize % LABEL_WORD_BITS == 0 ? ~ParallelLabel(0)
+		: (ParallelLabel(1) << (bitsetSize % LABEL_WORD_BITS)) - 1;
+};
+
+enum class SimdLevel { SCALAR = 0, AVX2 = 1, AVX512 = 2 };
+
+// words covered by one vector register
+const std::size_t AVX2_WORDS = 4;
+const std::size_t AVX512_WORDS = 8;
+
+inline SimdLevel detectSimdLevel()
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return SimdLevel::AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return SimdLevel::AVX2;
+	return SimdLevel::SCALAR;
+}
+
+// The detected level is computed once at startup. It can be lowered (never raised above what the
+// CPU supports) with setLabelSimdLevel, e.g. to compare the kernels against each other.
+template < typename T = void >
+struct LabelSimdDispatch
+{
+	static const SimdLevel detected;
+	static const bool hasVpopcnt;
+	static SimdLevel level;
+};
+
+template < typename T >
+const SimdLevel LabelSimdDispatch<T>::detected = detectSimdLevel();
+
+template < typename T >
+const bool LabelSimdDispatch<T>::hasVpopcnt = (__builtin_cpu_init(), __builtin_cpu_supports("avx512vpopcntdq"));
+
+template < typename T >
+SimdLevel LabelSimdDispatch<T>::level = LabelSimdDispatch<T>::detected;
+
+inline SimdLevel labelSimdLevel()
+{
+	return LabelSimdDispatch<>::level;
+}
+
+inline SimdLevel setLabelSimdLevel(SimdLevel level)
+{
+	LabelSimdDispatch<>::level = level < LabelSimdDispatch<>::detected ? level : LabelSimdDispatch<>::detected;
+	return LabelSimdDispatch<>::level;
+}
+
+inline const char* simdLevelName(SimdLevel level)
+{
+	switch (level)
+	{
+		case SimdLevel::AVX512: return "avx512";
+		case SimdLevel::AVX2: return "avx2";
+		default: return "scalar";
+	}
+}
+
+// AVX2 kernels
+
+template < std::size_t words >
+__attribute__((target("avx2"))) void labelOrAvx2(ParallelLabel* dst, const ParallelLabel* src)
+{
+	std::size_t w = 0;
+	for (; w + AVX2_WORDS <= words; w += AVX2_WORDS)
+	{
+		__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + w));
+		__m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + w));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + w), _mm256_or_si256(d, s));
+	}
+	for (; w < words; ++w)
+		dst[w] |= src[w];
+}
+
+template < std::size_t words >
+__attribute__((target("avx2"))) void labelAndNotAvx2(ParallelLabel* dst, const ParallelLabel* src)
+{
+	std::size_t w = 0;
+	for (; w + AVX2_WORDS <= words; w += AVX2_WORDS)
+	{
+		__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + w));
+		__m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + w));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + w), _mm256_andnot_si256(s, d));
+	}
+	for (; w < words; ++w)
+		dst[w] &= ~src[w];
+}
+
+template < std::size_t words >
+__attribute__((target("avx2"))) bool labelIsZeroAvx2(const ParallelLabel* label)
+{
+	__m256i acc = _mm256_setzero_si256();
+	std::size_t w = 0;
+	for (; w + AVX2_WORDS <= words; w += AVX2_WORDS)
+		acc = _mm256_or_si256(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(label + w)));
+	ParallelLabel rest = 0;
+	for (; w < words; ++w)
+		rest |= label[w];
+	return _mm256_testz_si256(acc, acc) && rest == 0;
+}
+
+// popcount of every byte through a nibble lookup table, summed up with sad
+template < std::size_t words >
+__attribute__((target("avx2,popcnt"))) std::size_t labelCountAvx2(const ParallelLabel* label)
+{
+	const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+	                                        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i lowMask = _mm256_set1_epi8(0x0f);
+	__m256i acc = _mm256_setzero_si256();
+	std::size_t w = 0;
+	for (; w + AVX2_WORDS <= words; w += AVX2_WORDS)
+	{
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(label + w));
+		__m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, lowMask));
+		__m256i hi = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), lowMask));
+		acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+	}
+	std::size_t count = _mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1)
+	                  + _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3);
+	for (; w < words; ++w)
+		count += __builtin_popcountll(label[w]);
+	return count;
+}
+
+// AVX-512 kernels
+
+template < std::size_t words >
+__attribute__((target("avx512f"))) void labelOrAvx512(ParallelLabel* dst, const ParallelLabel* src)
+{
+	std::size_t w = 0;
+	for (; w + AVX512_WORDS <= words; w += AVX512_WORDS)
+	{
+		__m512i d = _mm512_loadu_si512(dst + w);
+		__m512i s = _mm512_loadu_si512(src + w);
+		_mm512_storeu_si512(dst + w, _mm512_or_si512(d, s));
+	}
+	if (w < words)
+	{
+		__mmask8 tail = (1u << (words - w)) - 1;
+		__m512i d = _mm512_maskz_loadu_epi64(tail, dst + w);
+		__m512i s = _mm512_maskz_loadu_epi64(tail, src + w);
+		_mm512_mask_storeu_epi64(dst + w, tail, _mm512_or_si512(d, s));
+	}
+}
+
+template < std::size_t words >
+__attribute__((target("avx512f"))) void labelAndNotAvx512(ParallelLabel* dst, const ParallelLabel* src)
+{
+	std::size_t w = 0;
+	for (; w + AVX512_WORDS <= words; w += AVX512_WORDS)
+	{
+		__m512i d = _mm512_loadu_si512(dst + w);
+		__m512i s = _mm512_loadu_si512(src + w);
+		_mm512_storeu_si512(dst + w, _mm512_andnot_si512(s, d));
+	}
+	if (w < words)
+	{
+		__mmask8 tail = (1u << (words - w)) - 1;
+		__m512i d = _mm512_maskz_loadu_epi64(tail, dst + w);
+		__m512i s = _mm512_maskz_loadu_epi64(tail, src + w);
+		_mm512_mask_storeu_epi64(dst + w, tail, _mm512_andnot_si512(s, d));
+	}
+}
+
+template < std::size_t words >
+__attribute__((target("avx512f"))) bool labelIsZeroAvx512(const ParallelLabel* label)
+{
+	__m512i acc = _mm512_setzero_si512();
+	std::size_t w = 0;
+	for (; w + AVX512_WORDS <= words; w += AVX512_WORDS)
+		acc = _mm512_or_si512(acc, _mm512_loadu_si512(label + w));
+	if (w < words)
+		acc = _mm512_or_si512(acc, _mm512_maskz_loadu_epi64((1u << (words - w)) - 1, label + w));
+	return _mm512_test_epi64_mask(acc, acc) == 0;
+}
+
+template < std::size_t words >
+__attribute__((target("avx512f,avx512vpopcntdq"))) std::size_t labelCountAvx512(const ParallelLabel* label)
+{
+	__m512i acc = _mm512_setzero_si512();
+	std::size_t w = 0;
+	for (; w + AVX512_WORDS <= words; w += AVX512_WORDS)
+		acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_loadu_si512(label + w)));
+	if (w < words)
+		acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_maskz_loadu_epi64((1u << (words - w)) - 1, label + w)));
+	return _mm512_reduce_add_epi64(acc);
+}
+
+// Dispatching entry points, these are what the traversal kernels use.
+
+template < std::size_t words >
+inline bool labelIsZero(const ParallelLabel* label)
+{
+	if (words >= AVX512_WORDS && labelSimdLevel() == SimdLevel::AVX512)
+		return labelIsZeroAvx512<words>(label);
+	if (words >= AVX2_WORDS && labelSimdLevel() >= SimdLevel::AVX2)
+		return labelIsZeroAvx2<words>(label);
+	ParallelLabel acc = 0;
+	for (std::size_t w = 0; w < words; ++w)
+		acc |= label[w];
+	return acc == 0;
+}
+
+template < std::size_t words >
+inline void labelOr(ParallelLabel* dst, const ParallelLabel* src)
+{
+	if (words >= AVX512_WORDS && labelSimdLevel() == SimdLevel::AVX512)
+		return labelOrAvx512<words>(dst, src);
+	if (words >= AVX2_WORDS && labelSimdLevel() >= SimdLevel::AVX2)
+		return labelOrAvx2<words>(dst, src);
+	for (std::size_t w = 0; w < words; ++w)
+		dst[w] |= src[w];
+}
+
+template < std::size_t words >
+inline void labelAndNot(ParallelLabel* dst, const ParallelLabel* src)
+{
+	if (words >= AVX512_WORDS && labelSimdLevel() == SimdLevel::AVX512)
+		return labelAndNotAvx512<words>(dst, src);
+	if (words >= AVX2_WORDS && labelSimdLevel() >= SimdLevel::AVX2)
+		return labelAndNotAvx2<words>(dst, src);
+	for (std::size_t w = 0; w < words; ++w)
+		dst[w] &= ~src[w];
+}
+
+// number of sources in the label
+template < std::size_t words >
+inline std::size_t labelCount(const ParallelLabel* label)
+{
+	if (words >= AVX512_WORDS && labelSimdLevel() == SimdLevel::AVX512 && LabelSimdDispatch<>::hasVpopcnt)
+		return labelCountAvx512<words>(label);
+	if (words >= AVX2_WORDS && labelSimdLevel() >= SimdLevel::AVX2)
+		return labelCountAvx2<words>(label);
+	std::size_t count = 0;
+	for (std::size_t w = 0; w < words; ++w)
+		count += __builtin_popcountll(label[w]);
+	return count;
+}
+
+template < std::size_t words >
+inline bool labelEquals(const ParallelLabel* lhs, const ParallelLabel* rhs)
+{
+	for (std::size_t w = 0; w < words; ++w)
+		if (lhs[w] != rhs[w])
+			return false;
+	return true;
+}
+
+// true if every bit of mask is set in label
+template < std::size_t words >
+inline bool labelCovers(const ParallelLabel* label, const ParallelLabel* mask)
+{
+	for (std::size_t w = 0; w < words; ++w)
+		if ((label[w] & mask[w]) != mask[w])
+			return false;
+	return true;
+}
+
+// true if all bitsetSize bits are set, i.e. a full batch of sources; the mask is a compile-time constant
+template < unsigned int bitsetSize >
+inline bool labelIsFull(const ParallelLabel* label)
+{
+	const std::size_t words = LabelWords<bitsetSize>::count;
+	for (std::size_t w = 0; w + 1 < words; ++w)
+		if (label[w] != ~ParallelLabel(0))
+			return false;
+	return label[words - 1] == LabelWords<bitsetSize>::lastWordMask;
+}
+
+template < std::size_t words >
+inline void labelClear(ParallelLabel* label)
+{
+	for (std::size_t w = 0; w < words; ++w)
+		label[w] = 0;
+}
+
+// sets bit i of a multi-word label
+inline void labelSet(ParallelLabel* label, std::size_t i)
+{
+	label[i / LABEL_WORD_BITS] |= ParallelLabel(1) << (i % LABEL_WORD_BITS);
+}
+
+template < unsigned int bitsetSize >
+std::bitset<bitsetSize> toBitset(const ParallelLabel* label)
+{
+	std::bitset<bitsetSize> result;
+	for (std::size_t w = 0; w < LabelWords<bitsetSize>::count; ++w)
+	{
+		for (ParallelLabel bits = label[w]; bits != 0; bits &= bits - 1)
+			result.set(w * LABEL_WORD_BITS + __builtin_ctzll(bits));
+	}
+	return result;
+}
+
+// calls f(i) for every set bit i of a multi-word label, in increasing order
+template < std::size_t words, typename Function >
+inline void labelForEachBit(const ParallelLabel* label, Function f)
+{
+	for (std::size_t w = 0; w < words; ++w)
+	{
+		for (ParallelLabel bits = label[w]; bits != 0; bits &= bits - 1)
+			f(w * LABEL_WORD_BITS + __builtin_ctzll(bits));
+	}
+}
+
+// Label widths a run can be instantiated with, one to eight words.
+template < unsigned int bitsetSize >
+using LabelWidth = std::integral_constant<unsigned int, bitsetSize>;
+
+// Calls f(LabelWidth<bits>()) with the narrowest width that takes sourceCount sources in one batch, or
+// the widest one if none does (the runs then take several batches). Every width is a separate
+// instantiation of whatever f runs, so a 3 source run does not pay for 512 bit labels:
+//
+//   withLabelWidth(sources.size(), [&] (auto width) {
+//       MsBfs<decltype(width)::value, Sink> engine(g); ...
+//   });
+template < typename Function >
+inline auto withLabelWidth(std::size_t sourceCount, Function f)
+{
+	if (sourceCount <= 64)
+		return f(LabelWidth<64>());
+	if (sourceCount <= 128)
+		return f(LabelWidth<128>());
+	if (sourceCount <= 256)
+		return f(LabelWidth<256>());
+	return f(LabelWidth<512>());
+}
+
+#endif
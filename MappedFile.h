@@ -0,0 +1,147 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only memory mapping of a whole file, unmapped on destruction.
+class MappedFile
+{
+public:
+    MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const;
+    std::size_t size() const;
+private:
+    void* address;
+    std::size_t length;
+};
+
+inline MappedFile::MappedFile(const std::string& path): address(MAP_FAILED), length(0)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        throw std::runtime_error("cannot open " + path);
+    }
+
+    struct stat status;
+    if(fstat(fd, &status) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("cannot stat " + path);
+    }
+    length = status.st_size;
+
+    if(length > 0)
+    {
+        address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd); // the mapping keeps the file open
+    if(length > 0 && address == MAP_FAILED)
+    {
+        throw std::runtime_error("cannot map " + path);
+    }
+    if(length > 0)
+    {
+        // start reading the pages in the background, the traversal touches all of them
+        madvise(address, length, MADV_WILLNEED);
+    }
+}
+
+inline MappedFile::~MappedFile()
+{
+    if(address != MAP_FAILED)
+    {
+        munmap(address, length);
+    }
+}
+
+inline const char* MappedFile::data() const
+{
+    return static_cast<const char*>(address);
+}
+
+inline std::size_t MappedFile::size() const
+{
+    return length;
+}
+
+// Shared writable mapping of a new file of a fixed size, for output that is filled in place
+// (see DistanceFile.h). The file starts out zeroed; the pages are written back when unmapped.
+class MappedOutputFile
+{
+public:
+    MappedOutputFile(const std::string& path, std::size_t size);
+    ~MappedOutputFile();
+    MappedOutputFile(const MappedOutputFile&) = delete;
+    MappedOutputFile& operator=(const MappedOutputFile&) = delete;
+
+    char* data();
+    std::size_t size() const;
+    // writes the dirty pages back and waits for it
+    void sync();
+private:
+    void* address;
+    std::size_t length;
+};
+
+inline MappedOutputFile::MappedOutputFile(const std::string& path, std::size_t size): address(MAP_FAILED), length(size)
+{
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+    {
+        throw std::runtime_error("cannot create " + path);
+    }
+    if(ftruncate(fd, length) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("cannot resize " + path);
+    }
+    if(length > 0)
+    {
+        address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if(length > 0 && address == MAP_FAILED)
+    {
+        throw std::runtime_error("cannot map " + path);
+    }
+}
+
+inline MappedOutputFile::~MappedOutputFile()
+{
+    if(address != MAP_FAILED)
+    {
+        munmap(address, length);
+    }
+}
+
+inline char* MappedOutputFile::data()
+{
+    return static_cast<char*>(address);
+}
+
+inline std::size_t MappedOutputFile::size() const
+{
+    return length;
+}
+
+inline void MappedOutputFile::sync()
+{
+    if(address != MAP_FAILED && msync(address, length, MS_SYNC) != 0)
+    {
+        throw std::runtime_error("cannot write back the mapped output");
+    }
+}
+
+#endif
@@ -3,321 +3,1446 @@
 
 #include "tbb/blocked_range.h"
 #include "tbb/parallel_for.h"
+#include "tbb/partitioner.h"
+#include "tbb/task_arena.h"
 #include "tbb/task_scheduler_init.h"
 
+#include <thread>
+
 #include "Types.h"
+#include "CsrGraph.h"
+#include "ResultSinks.h"
+#include "Profile.h"
+#include "NumaPlacement.h"
+#include "EngineArena.h"
+#include "AllocationCounter.h"
+
+using VertexAppender = ChunkedList<VertexId>::Appender;
 
 
-template <unsigned int bitsetSize, typename Call>
+template <unsigned int bitsetSize, typename Sink>
 class MsBfsTask;
 
-template <unsigned int bitsetSize>
+// Every level is a single parallel pass. A top-down pass takes the label a vertex got on the level before,
+// drops the bits already seen, reports it and scatters what is left, all in one go. The 'frontier' array is
+// only read by the owner of each vertex, so the pass clears it as well and it can be the next 'next' without
+// a cleaning sweep. Labels produced by a top-down scatter are raw (not yet masked with 'seen') until the next
+// pass. The bottom-up kernel needs final frontier labels, a raw level is finalized by a separate pass first.
+// An engine is meant to live as long as its graph: the partitions, hubs and label arrays are set up once
+// by the constructor, and every batch of every run only resets the labels the batch before has written.
+// Everything else a run needs (the vertex lists, the per-worker list chunks and hub buffers) is carved
+// from one arena sized by the constructor (see EngineArena.h), so a run does not allocate at all.
+// The placement (see NumaPlacement.h) is fixed with the engine as well, it moves the label arrays and the
+// adjacency onto the memory nodes and, for Local, runs the task passes of each node in an arena pinned there.
+template <unsigned int bitsetSize, typename Sink = CallbackSink<bitsetSize>>
 class MsBfs
 {
 public:
-    static const int NODE_PER_WORKER;
+    // The vertices are cut into contiguous ranges of about equal edge count, TASKS_PER_THREAD of them per
+    // worker but at least MIN_TASK_EDGES edges (plus one per vertex) each. A vertex with more edges than
+    // a whole task gets its adjacency split into several tasks of its own.
+    static const std::size_t TASKS_PER_THREAD;
+    static const EdgeIndex MIN_TASK_EDGES;
+    // number of list entries a worker takes at once on sparse levels
+    static const std::size_t SPARSE_GRAIN;
+    // direction switching thresholds of the hybrid mode (Beamer et al.): go bottom-up when the edges
+    // to check from the frontier exceed unexplored edges / alpha, go back top-down when the frontier
+    // has less than nodes / beta vertices
+    static const double HYBRID_ALPHA;
+    static const double HYBRID_BETA;
+    // Vertices with at least HUB_DEGREE_FACTOR times the average degree (and HUB_MIN_DEGREE) are hubs.
+    // The top-down scatter collects the updates of at most MAX_HUBS of them in thread-local buffers
+    // and merges those once per level, instead of having every worker hammer the same words.
+    static const double HUB_DEGREE_FACTOR;
+    static const EdgeIndex HUB_MIN_DEGREE;
+    static const std::size_t MAX_HUBS;
+    // A top-down level is sparse while the frontier has less than nodes / SPARSE_FRONTIER_DIVISOR edges.
+    // Sparse levels only visit the frontier list and the vertices it touched instead of sweeping every vertex.
+    static const std::size_t SPARSE_FRONTIER_DIVISOR;
+    // number of words a label of this engine occupies
+    static constexpr std::size_t WORDS = LabelWords<bitsetSize>::count;
 
-    MsBfs(const ListGraph& g_):g(g_) {
+    // With a maxMemory budget (in bytes, 0 for none) the constructor throws before it allocates anything
+    // if the engine would take more than that, see memoryBytes().
+    MsBfs(const CsrGraph& g_, NumaPlacement placement_ = NumaPlacement::Naive, std::size_t maxMemory = 0):
+        g(withinMemoryBudget(g_, maxMemory)), map1(g_.nodeNum() * WORDS), map2(g_.nodeNum() * WORDS), seenMap(g_.nodeNum() * WORDS),
+        touchedMap1((g_.nodeNum() + LABEL_WORD_BITS - 1) / LABEL_WORD_BITS), touchedMap2(touchedMap1.size()),
+        ptrTouched(&touchedMap1), ptrConsumed(&touchedMap2), labelsClean(true), levelNum(0), barrierNum(0),
+        placement(placement_), placedByteNum(0) {
+        initHubs();
+        initPartitions();
+        slotNum = workerSlotNum(std::max(1, tbb::this_task_arena::max_concurrency()));
+        runArena.reserve(runStateBytes(g.nodeNum(), slotNum, hubs.size()));
+        initRunState();
+        initPlacement();
     }
 
-    void topDownMsPbfs(const std::vector<Node>& sources, std::function<PrintFunctionType<bitsetSize>> callback);
-    void bottomUpMsPbfs(const std::vector<Node>& sources, std::function<PrintFunctionType<bitsetSize>> callback);
-    void foundNew();
-    ListGraph::NodeMap<ParallelLabel>& seen();
-    ListGraph::NodeMap<ParallelLabel>& frontier();
-    ListGraph::NodeMap<ParallelLabel>& next();
-    const ListGraph& getGraph();
+    // Memory an engine for g takes on top of the graph when it is built in an arena of threadNumber
+    // workers: the label arrays and the run arena. The arena pages only become resident as far as the
+    // runs touch them, so this is the most a run can use, not what it usually does.
+    static std::size_t memoryBytes(const CsrGraph& g, std::size_t threadNumber);
+    // whether that fits in maxMemory bytes, 0 stands for no limit
+    static bool fitsMemoryBudget(const CsrGraph& g, std::size_t threadNumber, std::size_t maxMemory);
+
+    // Both runs accept any number of sources, they are processed in batches of bitsetSize.
+    // The discoveries go to the sink (see ResultSinks.h), bit i of a label stands for source firstSource + i of the batch.
+    void topDownMsPbfs(const std::vector<VertexId>& sources, Sink& sink);
+    void bottomUpMsPbfs(const std::vector<VertexId>& sources, Sink& sink);
+    // switches between the top-down and the bottom-up kernels on each level
+    void hybridMsPbfs(const std::vector<VertexId>& sources, Sink& sink,
+                      double alpha = HYBRID_ALPHA, double beta = HYBRID_BETA);
+
+    // per vertex kernels, used by the task sweeps of dense levels and by the lists of sparse levels
+    void expandNode(VertexId v, ParallelLabel* hubBuffer, VertexAppender* touched, VertexAppender& newFrontier,
+                    ScatterStats& scatterStats, LevelStats& levelStats);
+    // scatters the edges [sliceBegin, sliceEnd) of a split vertex, its label is prepared before the pass
+    void expandSplit(std::size_t splitIndex, EdgeIndex sliceBegin, EdgeIndex sliceEnd, ParallelLabel* hubBuffer,
+                     VertexAppender* touched, ScatterStats& stats);
+    void processNode(VertexId v, VertexAppender& newFrontier, LevelStats& stats);
+    void bottomUpNode(VertexId v, VertexAppender& newFrontier, LevelStats& stats);
+    void cleanNode(VertexId v);
+    // sparse level passes over a range of the active, touched and previous frontier lists
+    void scatterSparse(std::size_t begin, std::size_t end);
+    void processSparse(std::size_t begin, std::size_t end);
+    void cleanSparse(std::size_t begin, std::size_t end);
+
+    void addLevelStats(const LevelStats& stats);
+    void addScatterStats(const ScatterStats& stats);
+    ScatterStats getScatterStats();
+    // adjacency entries the bottom-up levels of the last run read and skipped
+    BottomUpStats getBottomUpStats();
+    // per level records of the runs, empty unless built with MSBFS_PROFILE (see Profile.h)
+    EngineProfiler& getProfiler();
+    // levels and parallel passes (i.e. barriers) of the last run
+    std::size_t getLevelNum();
+    std::size_t getBarrierNum();
+    bool hasHubs();
+    ParallelLabel* localHubBuffer();
+    VertexAppender& localFrontier();
+    VertexAppender* localTouchedList();
+    void mergeHubBuffers(std::size_t begin, std::size_t end);
+    LabelArray& seen();
+    LabelArray& frontier();
+    LabelArray& next();
+    const CsrGraph& getGraph();
     std::size_t getIterationNum();
+    std::size_t getFirstSource();
+    NumaPlacement getPlacement();
+    // bytes of labels and adjacency the kernel actually placed, 0 for Naive or without NUMA support
+    std::size_t placedBytes();
+    // bytes reserved for the run state, and operator new calls inside the level loops of the last run
+    // (counted only in programs that count allocations, see AllocationCounter.h)
+    std::size_t arenaBytes();
+    std::uint64_t getLevelAllocations();
+    // hands the pages of the run state back to the kernel, the next run touches them again
+    void releaseRunMemory();
 private:
-    void initTasks(std::function<PrintFunctionType<bitsetSize>> callback);
-    void getOrderNodesDegree(std::vector<Node> &degreeOrderedNodes);
-    const ListGraph& g;
-    std::vector<MsBfsTask<bitsetSize, std::function<PrintFunctionType<bitsetSize>>>> tasks;   
-    ListGraph::NodeMap<ParallelLabel>* ptrFrontier;
-    ListGraph::NodeMap<ParallelLabel>* ptrNext;
-    ListGraph::NodeMap<ParallelLabel>* ptrSeen;
-    std::atomic<bool> foundNewNode;
+    void initTasks(Sink& sink);
+    void initPartitions();
+    void initHubs();
+    static double hubThreshold(const CsrGraph& g);
+    void initPlacement();
+    void initRunState();
+    static std::size_t workerSlotNum(std::size_t threadNumber);
+    static std::size_t hubBufferStride(std::size_t hubNum);
+    static std::size_t runStateBytes(VertexId nodeNum, std::size_t slots, std::size_t hubNum);
+    static std::size_t visitedCapacity(VertexId nodeNum);
+    static const CsrGraph& withinMemoryBudget(const CsrGraph& g, std::size_t maxMemory);
+    std::size_t workerSlot();
+    void placeVertices(VertexId begin, VertexId end, int node);
+    void initLabels(const std::vector<VertexId>& sources, std::size_t first, std::size_t count);
+    void resetLabels();
+    void topDownBatch(const std::vector<VertexId>& sources, std::size_t first, std::size_t count);
+    void bottomUpBatch(const std::vector<VertexId>& sources, std::size_t first, std::size_t count);
+    void hybridBatch(const std::vector<VertexId>& sources, std::size_t first, std::size_t count, double alpha, double beta);
+    bool finalizeNode(VertexId v, ParallelLabel* label, VertexAppender& newFrontier, LevelStats& stats);
+    bool allSourcesSeen(const ParallelLabel* seenLabel) const;
+    void scatterLabel(VertexId v, const ParallelLabel* label, EdgeIndex sliceBegin, EdgeIndex sliceEnd, ParallelLabel* hubBuffer,
+                      VertexAppender* touched, ScatterStats& stats);
+    void prepareSplitNodes();
+    void resetLevelStats();
+    void consumeTouched(bool sparse);
+    void cleanNext();
+    void endLevel();
+    void expandLevel();
+    void finalizeLevel();
+    void bottomUpLevel();
+    template <typename Executor>
+    void forEachTask(const Executor& executor, PassKind kind = PassKind::Tasks);
+    template <typename Executor>
+    void forEachEntry(std::size_t size, const Executor& executor, PassKind kind = PassKind::Entries);
+    ProfileCounters profileCounters();
+    void beginStep(const char* direction, std::size_t level);
+    void endStep();
+    void touch(VertexId v, VertexAppender& touched);
+    const CsrGraph& g;
+    std::vector<MsBfsTask<bitsetSize, Sink>> tasks;
+    std::vector<VertexId> splitNodes; // vertices whose adjacency is split over several tasks
+    LabelArray splitLabels;           // their labels for the running pass
+    Sink* sink;
+    // during the loop we always use the previous 'next' as the new 'frontier'. To avoid data copying we are simply swapping two arrays in each iteration.
+    // The arrays are allocated once with the engine and reused by every run.
+    LabelArray map1; // we use map1 as the frontier at first
+    LabelArray map2;
+    LabelArray seenMap;
+    LabelArray* ptrFrontier;
+    LabelArray* ptrNext;
+    LabelArray* ptrSeen;
+    ParallelLabel allSeenLabel[WORDS]; // bits of the sources in the current batch
+    bool fullBatch; // the batch uses all bitsetSize bits, allSeenLabel is the constant LabelWords mask
+    bool rawFrontier; // 'frontier' holds labels as they were scattered, not yet masked with 'seen'
+    bool dirtyNext;   // 'next' still holds the frontier of the level before, left there by a bottom-up level
+    // The vertices with a non-zero label in 'frontier' and the frontier of the level before.
+    // Touched are the vertices a scatter wrote, the touched maps make sure each is listed once. A pass
+    // consumes the map of the scatter before while its own scatter marks the other one.
+    ArenaList<VertexId> frontierList;
+    ArenaList<VertexId> previousList;
+    ArenaList<VertexId> touchedList;
+    ArenaList<VertexId>* ptrActive; // list a sparse scatter walks
+    LabelArray touchedMap1;
+    LabelArray touchedMap2;
+    LabelArray* ptrTouched;
+    LabelArray* ptrConsumed;
+    bool trackTouched;   // the running scatter lists the vertices it writes
+    bool touchedPending; // touchedList holds every vertex with a label in 'frontier'
+    // every vertex that entered a frontier of the batch, the only ones whose labels the batch can leave non-zero
+    ArenaList<VertexId> visitedList;
+    bool labelsClean; // no batch ran since the arrays were wiped
+    // what the workers of a pass add to the next frontier and touched lists, gathered after the pass
+    ChunkedList<VertexId> localFrontiers;
+    ChunkedList<VertexId> localTouched;
+    // size and edges of the last finalized level, edges of vertices that are not yet seen by every source
+    std::atomic<std::size_t> frontierNodeNum;
+    std::atomic<EdgeIndex> frontierEdgeNum;
+    std::atomic<EdgeIndex> unexploredEdgeNum;
     std::size_t iterationNum;
-    std::size_t test;
+    std::size_t firstSource;
+    std::size_t levelNum;
+    std::size_t barrierNum;
+    std::vector<VertexId> hubs;
+    std::vector<VertexId> hubIndices; // vertex -> index in hubs or INVALID_VERTEX
+    // per worker slot, the labels of all hubs (hubBufferStride words apart) and whether the worker used them
+    ParallelLabel* hubBuffers;
+    bool* hubBuffersUsed;
+    std::atomic<std::uint64_t> atomicUpdateNum;
+    std::atomic<std::uint64_t> skippedUpdateNum;
+    std::atomic<std::uint64_t> bufferedUpdateNum;
+    std::atomic<EdgeIndex> checkedEdgeNum;
+    std::atomic<EdgeIndex> skippedEdgeNum;
+    std::atomic<std::uint64_t> scannedEdgeNum;
+    std::atomic<EdgeIndex> traversedEdgeNum;
+    EngineProfiler profiler;
+    NumaPlacement placement;
+    std::unique_ptr<NumaArenas> numaArenas; // Local only, one arena per node
+    std::vector<std::size_t> nodeTasks;     // Local only, the tasks of node i are [nodeTasks[i], nodeTasks[i + 1])
+    std::size_t placedByteNum;
+    EngineArena runArena;
+    std::size_t slotNum; // worker slots of the per-worker state, see workerSlot()
+    std::uint64_t levelAllocationNum;
 };
 
-template <unsigned int bitsetSize>
-const int MsBfs<bitsetSize>::NODE_PER_WORKER = 3;//256;
+template <unsigned int bitsetSize, typename Sink>
+const std::size_t MsBfs<bitsetSize, Sink>::TASKS_PER_THREAD = 8;
+
+template <unsigned int bitsetSize, typename Sink>
+const EdgeIndex MsBfs<bitsetSize, Sink>::MIN_TASK_EDGES = 4096;
+
+template <unsigned int bitsetSize, typename Sink>
+const std::size_t MsBfs<bitsetSize, Sink>::SPARSE_GRAIN = 64;
+
+template <unsigned int bitsetSize, typename Sink>
+const double MsBfs<bitsetSize, Sink>::HYBRID_ALPHA = 14;
+
+template <unsigned int bitsetSize, typename Sink>
+const double MsBfs<bitsetSize, Sink>::HYBRID_BETA = 24;
+
+template <unsigned int bitsetSize, typename Sink>
+const double MsBfs<bitsetSize, Sink>::HUB_DEGREE_FACTOR = 16;
+
+template <unsigned int bitsetSize, typename Sink>
+const EdgeIndex MsBfs<bitsetSize, Sink>::HUB_MIN_DEGREE = 64;
+
+template <unsigned int bitsetSize, typename Sink>
+const std::size_t MsBfs<bitsetSize, Sink>::MAX_HUBS = 4096;
+
+template <unsigned int bitsetSize, typename Sink>
+const std::size_t MsBfs<bitsetSize, Sink>::SPARSE_FRONTIER_DIVISOR = 16;
 
-template <unsigned int bitsetSize>
-void MsBfs<bitsetSize>::getOrderNodesDegree(std::vector<Node> &degreeOrderedNodes)
+template <unsigned int bitsetSize, typename Sink>
+constexpr std::size_t MsBfs<bitsetSize, Sink>::WORDS;
+
+template <unsigned int bitsetSize, typename Sink>
+double MsBfs<bitsetSize, Sink>::hubThreshold(const CsrGraph& g)
+{
+    return std::max<double>(HUB_MIN_DEGREE, HUB_DEGREE_FACTOR * g.edgeNum() / g.nodeNum());
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::initHubs()
 {
-    
-    InDegMap<ListGraph> degrees(g); 
-  
-    for (ListGraph::NodeIt n(g); n!=INVALID; ++n) {
-        degreeOrderedNodes.push_back(n);
+    hubIndices.assign(g.nodeNum(), INVALID_VERTEX);
+    if(g.nodeNum() == 0)
+    {
+        return;
+    }
+
+    double threshold = hubThreshold(g);
+    for (VertexId v = 0; v < g.nodeNum(); ++v)
+    {
+        if(g.degree(v) >= threshold)
+        {
+            hubs.push_back(v);
+        }
+    }
+    if(hubs.size() > MAX_HUBS)
+    {
+        std::nth_element(hubs.begin(), hubs.begin() + MAX_HUBS, hubs.end(),
+            [this] (VertexId lhs, VertexId rhs) {return g.degree(lhs) > g.degree(rhs);});
+        hubs.resize(MAX_HUBS);
+    }
+    for (std::size_t i = 0; i < hubs.size(); ++i)
+    {
+        hubIndices[hubs[i]] = i;
     }
-    std::sort(degreeOrderedNodes.begin(), degreeOrderedNodes.end(),
-        [&degrees] (const auto& lhs, const auto& rhs) {return degrees[lhs] > degrees[rhs];});
 }
 
-template <unsigned int bitsetSize, typename Call>
+// A task is either a contiguous range of whole vertices or one slice of the adjacency of a heavy vertex.
+// Only the first slice owns its vertex, the per-vertex passes skip the other ones.
+template <unsigned int bitsetSize, typename Sink>
 class MsBfsTask {
 public:
-    MsBfsTask(MsBfs<bitsetSize>* mspbfs_, Call callback_): taskNodes(), mspbfs(mspbfs_), callback(callback_)
+    MsBfsTask(MsBfs<bitsetSize, Sink>* mspbfs_, VertexId nodesBegin_, VertexId nodesEnd_):
+        nodesBegin(nodesBegin_), nodesEnd(nodesEnd_), splitIndex(INVALID_VERTEX), sliceBegin(0), sliceEnd(0), mspbfs(mspbfs_)
+    {}
 
-    {
-        taskNodes.reserve(MsBfs<bitsetSize>::NODE_PER_WORKER);        
+    MsBfsTask(MsBfs<bitsetSize, Sink>* mspbfs_, VertexId v, VertexId splitIndex_, EdgeIndex sliceBegin_, EdgeIndex sliceEnd_):
+        nodesBegin(v), nodesEnd(sliceBegin_ == 0 ? v + 1 : v), splitIndex(splitIndex_), sliceBegin(sliceBegin_), sliceEnd(sliceEnd_), mspbfs(mspbfs_)
+    {}
+
+    // first vertex of the range, or the split vertex
+    VertexId firstNode() const {
+        return nodesBegin;
     }
 
+    // a slice of a split vertex other than the first one
+    bool continuesSplit() const {
+        return splitIndex != INVALID_VERTEX && sliceBegin != 0;
+    }
+
+    // fused top-down level: finalize, report and scatter
     void getNeighboursTopDown() {
-        auto& g = mspbfs->getGraph();
-        auto& seen = mspbfs->seen();
-        auto& frontier = mspbfs->frontier();
-        auto& next = mspbfs->next();
-        int oldNext;
-        int newNext;
-        // body of the algorithm (Listing 1)
-        for (auto v: taskNodes)
+        ParallelLabel* hubBuffer = mspbfs->hasHubs() ? mspbfs->localHubBuffer() : nullptr;
+        VertexAppender* touched = mspbfs->localTouchedList();
+        ScatterStats scatterStats = {0, 0, 0, 0};
+        if(splitIndex != INVALID_VERTEX)
+        {
+            mspbfs->expandSplit(splitIndex, sliceBegin, sliceEnd, hubBuffer, touched, scatterStats);
+        }
+        else
         {
-            if(frontier[v]->load() == 0)
+            VertexAppender& newFrontier = mspbfs->localFrontier();
+            LevelStats levelStats = {0, 0, 0, 0, 0, 0};
+            for (VertexId v = nodesBegin; v < nodesEnd; ++v)
             {
-                continue;
+                mspbfs->expandNode(v, hubBuffer, touched, newFrontier, scatterStats, levelStats);
             }
+            mspbfs->addLevelStats(levelStats);
+        }
+        mspbfs->addScatterStats(scatterStats);
+    }
 
-            for (ListGraph::IncEdgeIt e(g, v); e!=INVALID; ++e) //iterating edges starting from v
-            {
+    // finalizes raw labels without scattering them, done before the hybrid goes bottom-up
+    void processNodesTopDown() {
+        VertexAppender& newFrontier = mspbfs->localFrontier();
+        LevelStats stats = {0, 0, 0, 0, 0, 0};
+        for (VertexId v = nodesBegin; v < nodesEnd; ++v)
+        {
+            mspbfs->processNode(v, newFrontier, stats);
+        }
+        mspbfs->addLevelStats(stats);
+    }
 
-                Node neighbour = g.runningNode(e); // 'other' end of edge (ie neighbours)
-                do {
-                    oldNext = next[neighbour]->load();
-                    newNext = oldNext | frontier[v]->load();
-                } while(!next[neighbour]->compare_exchange_weak(oldNext, newNext));
-            }
+    // the label of a vertex has to be complete before it is compared to 'seen', so bottom-up gathers whole adjacencies
+    void doBottomUp() {
+        VertexAppender& newFrontier = mspbfs->localFrontier();
+        LevelStats stats = {0, 0, 0, 0, 0, 0};
+        for (VertexId v = nodesBegin; v < nodesEnd; ++v)
+        {
+            mspbfs->bottomUpNode(v, newFrontier, stats);
         }
+        mspbfs->addLevelStats(stats);
     }
 
-    void processNodesTopDown() {
-        auto& g = mspbfs->getGraph();
-        auto& next = mspbfs->next();
-        auto& seen = mspbfs->seen();
-
-        for (auto v: taskNodes)
-        {   
-             // 
-            if(next[v]->load() == 0)
+    void cleanNext() {
+        for (VertexId v = nodesBegin; v < nodesEnd; ++v)
+        {
+            mspbfs->cleanNode(v);
+        }
+    }
+
+    private:
+        VertexId nodesBegin;
+        VertexId nodesEnd;
+        VertexId splitIndex;  // index in the split vertices or INVALID_VERTEX for a range of whole vertices
+        EdgeIndex sliceBegin; // edge range inside the adjacency of the split vertex
+        EdgeIndex sliceEnd;
+        MsBfs<bitsetSize, Sink>* mspbfs;
+};
+
+// Drops the bits of a raw label that were seen already and reports the rest. The label is zero afterwards
+// if nothing was new.
+template <unsigned int bitsetSize, typename Sink>
+bool MsBfs<bitsetSize, Sink>::finalizeNode(VertexId v, ParallelLabel* label, VertexAppender& newFrontier, LevelStats& stats)
+{
+    ParallelLabel* seenLabel = &(*ptrSeen)[v * WORDS];
+    labelAndNot<WORDS>(label, seenLabel);
+    if(labelIsZero<WORDS>(label))
+    {
+        return false;
+    }
+    labelOr<WORDS>(seenLabel, label);
+
+    sink->found(iterationNum, v, label);
+    newFrontier.push_back(v);
+    ++stats.frontierNodes;
+    stats.frontierEdges += g.degree(v);
+    if(EngineProfiler::ENABLED)
+    {
+        stats.traversedEdges += g.degree(v) * labelCount<WORDS>(label);
+    }
+    if(allSourcesSeen(seenLabel))
+    {
+        stats.exploredEdges += g.degree(v);
+    }
+    return true;
+}
+
+// Every batch but the last of a run is full, its test compares against a compile-time mask instead of
+// loading allSeenLabel.
+template <unsigned int bitsetSize, typename Sink>
+bool MsBfs<bitsetSize, Sink>::allSourcesSeen(const ParallelLabel* seenLabel) const
+{
+    return fullBatch ? labelIsFull<bitsetSize>(seenLabel) : labelEquals<WORDS>(seenLabel, allSeenLabel);
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::scatterLabel(VertexId v, const ParallelLabel* label, EdgeIndex sliceBegin, EdgeIndex sliceEnd, ParallelLabel* hubBuffer,
+                                     VertexAppender* touched, ScatterStats& stats)
+{
+    auto& next = *ptrNext;
+    stats.scannedEdges += sliceEnd - sliceBegin;
+
+    // body of the algorithm (Listing 1)
+    for (const VertexId* e = g.neighboursBegin(v) + sliceBegin; e != g.neighboursBegin(v) + sliceEnd; ++e) //iterating edges starting from v
+    {
+
+        VertexId neighbour = *e; // 'other' end of edge (ie neighbours)
+        VertexId hub = hubBuffer ? hubIndices[neighbour] : INVALID_VERTEX;
+        if(hub != INVALID_VERTEX)
+        {
+            labelOr<WORDS>(&hubBuffer[hub * WORDS], label);
+            ++stats.bufferedUpdates;
+            continue;
+        }
+
+        bool written = false;
+        for (std::size_t w = 0; w < WORDS; ++w)
+        {
+            if(label[w] == 0)
             {
                 continue;
             }
-
-            *(next[v]) &= ~(seen[v]->load());
-            *(seen[v]) |= next[v]->load();
-
-            if(next[v]->load() != 0)
+            // check before write: most of the time a popular neighbour already has these bits
+            ParallelLabel& nextWord = next[neighbour * WORDS + w];
+            if((atomicLoad(nextWord) & label[w]) == label[w])
             {
-                callback(mspbfs->getIterationNum(), g.id(v), g.maxNodeId(), next[v]->load());
-                mspbfs->foundNew();
+                ++stats.skippedUpdates;
+                continue;
             }
+            atomicFetchOr(nextWord, label[w]);
+            ++stats.atomicUpdates;
+            written = true;
         }
+        if(written && touched)
+        {
+            touch(neighbour, *touched);
+        }
+    }
+}
 
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::expandNode(VertexId v, ParallelLabel* hubBuffer, VertexAppender* touched, VertexAppender& newFrontier,
+                                   ScatterStats& scatterStats, LevelStats& levelStats)
+{
+    ParallelLabel* frontierLabel = &(*ptrFrontier)[v * WORDS];
+    ParallelLabel label[WORDS];
+    if(labelIsZero<WORDS>(frontierLabel))
+    {
+        return;
     }
+    // only the owner of v reads its frontier label, so it can be cleared for the next level right away
+    std::copy(frontierLabel, frontierLabel + WORDS, label);
+    labelClear<WORDS>(frontierLabel);
 
-    void doBottomUp() {
-        auto& g = mspbfs->getGraph();
-        auto& seen = mspbfs->seen();
-        auto& frontier = mspbfs->frontier();
-        auto& next = mspbfs->next();
+    if(rawFrontier && !finalizeNode(v, label, newFrontier, levelStats))
+    {
+        return;
+    }
+    scatterLabel(v, label, 0, g.degree(v), hubBuffer, touched, scatterStats);
+}
 
-        for (auto v: taskNodes)
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::expandSplit(std::size_t splitIndex, EdgeIndex sliceBegin, EdgeIndex sliceEnd, ParallelLabel* hubBuffer,
+                                    VertexAppender* touched, ScatterStats& stats)
+{
+    const ParallelLabel* label = &splitLabels[splitIndex * WORDS];
+    if(!labelIsZero<WORDS>(label))
+    {
+        scatterLabel(splitNodes[splitIndex], label, sliceBegin, sliceEnd, hubBuffer, touched, stats);
+    }
+}
+
+// The slices of a split vertex all need its final label, so it is taken out of 'frontier' before the pass.
+// There are at most a few per worker.
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::prepareSplitNodes()
+{
+    VertexAppender& newFrontier = localFrontier();
+    LevelStats stats = {0, 0, 0, 0, 0, 0};
+    for (std::size_t i = 0; i < splitNodes.size(); ++i)
+    {
+        ParallelLabel* frontierLabel = &(*ptrFrontier)[splitNodes[i] * WORDS];
+        ParallelLabel* label = &splitLabels[i * WORDS];
+        std::copy(frontierLabel, frontierLabel + WORDS, label);
+        labelClear<WORDS>(frontierLabel);
+        if(rawFrontier && !labelIsZero<WORDS>(label))
         {
-            if(seen[v]->load() == ~(-1 << bitsetSize))
-            {
-                continue;
-            }
+            finalizeNode(splitNodes[i], label, newFrontier, stats);
+        }
+    }
+    addLevelStats(stats);
+}
 
-            for (ListGraph::IncEdgeIt e(g, v); e!=INVALID; ++e) //iterating edges starting from v
-            {
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::processNode(VertexId v, VertexAppender& newFrontier, LevelStats& stats)
+{
+    ParallelLabel* label = &(*ptrFrontier)[v * WORDS];
+    if(!labelIsZero<WORDS>(label))
+    {
+        finalizeNode(v, label, newFrontier, stats);
+    }
+}
+
+// 'next' is overwritten rather than accumulated, so it does not need to be clean
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::bottomUpNode(VertexId v, VertexAppender& newFrontier, LevelStats& stats)
+{
+    auto& frontier = *ptrFrontier;
+    ParallelLabel* nextLabel = &(*ptrNext)[v * WORDS];
+    ParallelLabel label[WORDS];
+    if(allSourcesSeen(&(*ptrSeen)[v * WORDS]))
+    {
+        if(!labelIsZero<WORDS>(nextLabel))
+        {
+            labelClear<WORDS>(nextLabel);
+        }
+        return;
+    }
+
+    // the sources that have not reached v yet, once the neighbours cover all of them the rest of the
+    // adjacency cannot add anything
+    ParallelLabel missing[WORDS];
+    std::copy(allSeenLabel, allSeenLabel + WORDS, missing);
+    labelAndNot<WORDS>(missing, &(*ptrSeen)[v * WORDS]);
+
+    labelClear<WORDS>(label);
+    const VertexId* end = g.neighboursEnd(v);
+    for (const VertexId* e = g.neighboursBegin(v); e != end; ++e) //iterating edges starting from v
+    {
+
+        VertexId neighbour = *e; // 'other' end of edge (ie neighbours)
+        labelOr<WORDS>(label, &frontier[neighbour * WORDS]);
+        if(labelCovers<WORDS>(label, missing))
+        {
+            stats.skippedEdges += end - e - 1;
+            end = e + 1;
+            break;
+        }
+    }
+    stats.checkedEdges += end - g.neighboursBegin(v);
+    finalizeNode(v, label, newFrontier, stats);
+    std::copy(label, label + WORDS, nextLabel);
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::cleanNode(VertexId v)
+{
+    ParallelLabel* label = &(*ptrNext)[v * WORDS];
+    if(!labelIsZero<WORDS>(label))
+    {
+        labelClear<WORDS>(label);
+    }
+}
+
+// adds v to the touched list unless another worker already did
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::touch(VertexId v, VertexAppender& touched)
+{
+    ParallelLabel bit = ParallelLabel(1) << (v % LABEL_WORD_BITS);
+    ParallelLabel& word = (*ptrTouched)[v / LABEL_WORD_BITS];
+    if(!(atomicLoad(word) & bit) && !(atomicFetchOr(word, bit) & bit))
+    {
+        touched.push_back(v);
+    }
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::scatterSparse(std::size_t begin, std::size_t end)
+{
+    ParallelLabel* hubBuffer = hasHubs() ? localHubBuffer() : nullptr;
+    VertexAppender* touched = localTouchedList();
+    VertexAppender& newFrontier = localFrontier();
+    ScatterStats scatterStats = {0, 0, 0, 0};
+    LevelStats levelStats = {0, 0, 0, 0, 0, 0};
+    for(std::size_t i = begin; i < end; ++i)
+    {
+        VertexId v = (*ptrActive)[i];
+        if(rawFrontier)
+        {
+            // every bit set in the consumed map belongs to a vertex of touchedList, so the whole word can go
+            atomicStore((*ptrConsumed)[v / LABEL_WORD_BITS], 0);
+        }
+        expandNode(v, hubBuffer, touched, newFrontier, scatterStats, levelStats);
+    }
+    addScatterStats(scatterStats);
+    addLevelStats(levelStats);
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::processSparse(std::size_t begin, std::size_t end)
+{
+    VertexAppender& newFrontier = localFrontier();
+    LevelStats stats = {0, 0, 0, 0, 0, 0};
+    for(std::size_t i = begin; i < end; ++i)
+    {
+        VertexId v = touchedList[i];
+        atomicStore((*ptrConsumed)[v / LABEL_WORD_BITS], 0);
+        processNode(v, newFrontier, stats);
+    }
+    addLevelStats(stats);
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::cleanSparse(std::size_t begin, std::size_t end)
+{
+    for(std::size_t i = begin; i < end; ++i)
+    {
+        cleanNode(previousList[i]);
+    }
+}
+
+// The lists hold every vertex at most once, the chunked ones at most once per pass. The hub buffers of
+// the slots are a whole number of cache lines apart.
+template <unsigned int bitsetSize, typename Sink>
+std::size_t MsBfs<bitsetSize, Sink>::runStateBytes(VertexId nodeNum, std::size_t slots, std::size_t hubNum)
+{
+    std::size_t listCapacity = std::max<std::size_t>(nodeNum, bitsetSize);
+    return 3 * EngineArena::carvedSize<VertexId>(listCapacity) + EngineArena::carvedSize<VertexId>(visitedCapacity(nodeNum))
+           + 2 * ChunkedList<VertexId>::arenaBytes(listCapacity, slots)
+           + EngineArena::carvedSize<ParallelLabel>(slots * hubBufferStride(hubNum)) + EngineArena::carvedSize<bool>(slots);
+}
+
+// The visited list is the exception, a vertex the sources reach on different levels repeats in it. endLevel()
+// only appends while it is below nodes / SPARSE_FRONTIER_DIVISOR, and a level adds at most every vertex;
+// the sources of the batch come on top.
+template <unsigned int bitsetSize, typename Sink>
+std::size_t MsBfs<bitsetSize, Sink>::visitedCapacity(VertexId nodeNum)
+{
+    return std::size_t(nodeNum) + nodeNum / SPARSE_FRONTIER_DIVISOR + bitsetSize;
+}
+
+template <unsigned int bitsetSize, typename Sink>
+std::size_t MsBfs<bitsetSize, Sink>::hubBufferStride(std::size_t hubNum)
+{
+    const std::size_t lineWords = EngineArena::ALIGNMENT / sizeof(ParallelLabel);
+    return (hubNum * WORDS + lineWords - 1) / lineWords * lineWords;
+}
 
-                Node neighbour = g.runningNode(e); // 'other' end of edge (ie neighbours)
-                *next[v] |= frontier[neighbour]->load();
+// Slots for every worker of the arena the engine is built in, and at least one per hardware thread so
+// that running it from the default arena works as well.
+template <unsigned int bitsetSize, typename Sink>
+std::size_t MsBfs<bitsetSize, Sink>::workerSlotNum(std::size_t threadNumber)
+{
+    return std::max<std::size_t>(threadNumber, std::thread::hardware_concurrency());
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::initRunState()
+{
+    std::size_t listCapacity = std::max<std::size_t>(g.nodeNum(), bitsetSize);
+    for(ArenaList<VertexId>* list: {&frontierList, &previousList, &touchedList})
+    {
+        list->attach(runArena.carve<VertexId>(listCapacity), listCapacity);
+    }
+    visitedList.attach(runArena.carve<VertexId>(visitedCapacity(g.nodeNum())), visitedCapacity(g.nodeNum()));
+    localFrontiers.attach(runArena, listCapacity, slotNum);
+    localTouched.attach(runArena, listCapacity, slotNum);
+    hubBuffers = runArena.carve<ParallelLabel>(slotNum * hubBufferStride(hubs.size()));
+    hubBuffersUsed = runArena.carve<bool>(slotNum);
+}
+
+template <unsigned int bitsetSize, typename Sink>
+std::size_t MsBfs<bitsetSize, Sink>::memoryBytes(const CsrGraph& g, std::size_t threadNumber)
+{
+    std::size_t hubNum = 0;
+    if(g.nodeNum() > 0)
+    {
+        double threshold = hubThreshold(g);
+        for(VertexId v = 0; v < g.nodeNum(); ++v)
+        {
+            hubNum += g.degree(v) >= threshold;
+        }
+    }
+    std::size_t labelWords = 3 * std::size_t(g.nodeNum()) * WORDS + 2 * ((g.nodeNum() + LABEL_WORD_BITS - 1) / LABEL_WORD_BITS);
+    return labelWords * sizeof(ParallelLabel) + g.nodeNum() * sizeof(VertexId)
+           + runStateBytes(g.nodeNum(), workerSlotNum(threadNumber), std::min(hubNum, MAX_HUBS));
+}
+
+template <unsigned int bitsetSize, typename Sink>
+bool MsBfs<bitsetSize, Sink>::fitsMemoryBudget(const CsrGraph& g, std::size_t threadNumber, std::size_t maxMemory)
+{
+    return maxMemory == 0 || memoryBytes(g, threadNumber) <= maxMemory;
+}
+
+// checks the budget for the arena the engine is built in, ahead of the label arrays in the initializer list
+template <unsigned int bitsetSize, typename Sink>
+const CsrGraph& MsBfs<bitsetSize, Sink>::withinMemoryBudget(const CsrGraph& g, std::size_t maxMemory)
+{
+    std::size_t threadNumber = std::max(1, tbb::this_task_arena::max_concurrency());
+    if(!fitsMemoryBudget(g, threadNumber, maxMemory))
+    {
+        throw std::runtime_error("an engine of " + std::to_string(bitsetSize) + " bit labels on " + std::to_string(threadNumber)
+                                 + " threads needs " + std::to_string(memoryBytes(g, threadNumber) >> 20) + " MiB, the budget is "
+                                 + std::to_string(maxMemory >> 20) + " MiB");
+    }
+    return g;
+}
+
+// The slot of the calling worker among all workers that run the engine's passes. The sequential steps
+// between passes run on the calling thread, which need not be in an arena yet; no worker runs then, so
+// it takes slot 0.
+template <unsigned int bitsetSize, typename Sink>
+std::size_t MsBfs<bitsetSize, Sink>::workerSlot()
+{
+    int slot = profileSlotBase() + std::max(0, tbb::this_task_arena::current_thread_index());
+    if(slot < 0 || std::size_t(slot) >= slotNum)
+    {
+        throw std::runtime_error("worker " + std::to_string(slot) + " runs an engine built for " + std::to_string(slotNum) + " workers");
+    }
+    return slot;
+}
+
+// Cuts the vertices into contiguous ranges of about taskWeight edges (counting one extra per vertex, so that
+// ranges of isolated vertices stay bounded). The graph does not change, so this is done once per engine.
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::initPartitions()
+{
+    std::size_t threadNumber = std::max(1, tbb::this_task_arena::max_concurrency());
+    EdgeIndex taskWeight = std::max<EdgeIndex>(MIN_TASK_EDGES, (g.edgeNum() + g.nodeNum()) / (threadNumber * TASKS_PER_THREAD) + 1);
+
+    tasks.clear();
+    splitNodes.clear();
+    VertexId rangeBegin = 0;
+    EdgeIndex rangeWeight = 0;
+    for (VertexId v = 0; v < g.nodeNum(); ++v)
+    {
+        EdgeIndex degree = g.degree(v);
+        if(degree > taskWeight)
+        {
+            if(rangeBegin < v)
+            {
+                tasks.emplace_back(this, rangeBegin, v);
             }
-            *next[v] &= ~(seen[v]->load());
-            *seen[v] |= next[v]->load();
-            
-            if(next[v]->load() != 0)
+            // as many equal slices as it takes to stay under taskWeight
+            EdgeIndex sliceNumber = (degree + taskWeight - 1) / taskWeight;
+            for (EdgeIndex i = 0; i < sliceNumber; ++i)
             {
-                callback(mspbfs->getIterationNum(), g.id(v), g.maxNodeId(), next[v]->load());
-                mspbfs->foundNew();
+                tasks.emplace_back(this, v, VertexId(splitNodes.size()), degree * i / sliceNumber, degree * (i + 1) / sliceNumber);
             }
+            splitNodes.push_back(v);
+            rangeBegin = v + 1;
+            rangeWeight = 0;
+            continue;
+        }
+
+        rangeWeight += degree + 1;
+        if(rangeWeight >= taskWeight)
+        {
+            tasks.emplace_back(this, rangeBegin, v + 1);
+            rangeBegin = v + 1;
+            rangeWeight = 0;
         }
     }
+    if(rangeBegin < g.nodeNum() || tasks.empty())
+    {
+        tasks.emplace_back(this, rangeBegin, g.nodeNum());
+    }
+    splitLabels.assign(splitNodes.size() * WORDS, 0);
+}
 
-    void cleanNext() {
-        auto& g = mspbfs->getGraph();
-        auto& next = mspbfs->next();
-        for(auto v: taskNodes)
+// The tasks are cut into one run of about equal length per node (the tasks have about equal weight), and
+// the labels, touched bits and adjacency of each run's vertices go to its node. Interleaving spreads all of
+// it instead. The per-thread buffers (hubs, frontier lists) are left to first touch by their workers.
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::initPlacement()
+{
+    if(placement == NumaPlacement::Interleaved)
+    {
+        placeVertices(0, g.nodeNum(), -1);
+    }
+    if(placement != NumaPlacement::Local)
+    {
+        return;
+    }
+    numaArenas.reset(new NumaArenas(std::max(1, tbb::this_task_arena::max_concurrency())));
+    std::size_t nodeNumber = numaArenas->size();
+    nodeTasks.assign(1, 0);
+    for(std::size_t i = 1; i <= nodeNumber; ++i)
+    {
+        std::size_t end = tasks.size() * i / nodeNumber;
+        // the slices of a split vertex stay on one node
+        while(end > nodeTasks.back() && end < tasks.size() && tasks[end].continuesSplit())
+        {
+            ++end;
+        }
+        nodeTasks.push_back(std::max(end, nodeTasks.back()));
+    }
+    nodeTasks.back() = tasks.size();
+    for(std::size_t i = 0; i < nodeNumber; ++i)
+    {
+        if(nodeTasks[i] < nodeTasks[i + 1])
         {
-            next[v]->store(0);
+            VertexId end = nodeTasks[i + 1] < tasks.size() ? tasks[nodeTasks[i + 1]].firstNode() : g.nodeNum();
+            placeVertices(tasks[nodeTasks[i]].firstNode(), end, numaArenas->node(i).id);
         }
     }
+}
 
-    void addNode(Node n)
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::placeVertices(VertexId begin, VertexId end, int node)
+{
+    for(LabelArray* labels: {&map1, &map2, &seenMap})
     {
-        taskNodes.push_back(n);
+        placedByteNum += placeMemory(labels->data() + std::size_t(begin) * WORDS, std::size_t(end - begin) * WORDS * sizeof(ParallelLabel), node);
     }
-    private:
-        std::vector<Node> taskNodes;
-        MsBfs<bitsetSize>* mspbfs;
-        Call callback;
-};
+    for(LabelArray* bits: {&touchedMap1, &touchedMap2})
+    {
+        placedByteNum += placeMemory(bits->data() + begin / LABEL_WORD_BITS, (end - begin) / LABEL_WORD_BITS * sizeof(ParallelLabel), node);
+    }
+    placedByteNum += placeMemory(g.offsetData() + begin, std::size_t(end - begin) * sizeof(EdgeIndex), node);
+    placedByteNum += placeMemory(g.neighbourData() + g.offsetData()[begin],
+                                 (g.offsetData()[end] - g.offsetData()[begin]) * sizeof(VertexId), node);
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::initTasks(Sink& sink)
+{
+    this->sink = &sink;
+    atomicUpdateNum.store(0);
+    skippedUpdateNum.store(0);
+    bufferedUpdateNum.store(0);
+    checkedEdgeNum.store(0);
+    skippedEdgeNum.store(0);
+    scannedEdgeNum.store(0);
+    traversedEdgeNum.store(0);
+    levelAllocationNum = 0;
+    levelNum = 0;
+    barrierNum = 0;
+}
 
-template <unsigned int bitsetSize>
-void MsBfs<bitsetSize>::initTasks(std::function<PrintFunctionType<bitsetSize>> callback)
+// The tasks are already balanced chunks of work, every one of them becomes a TBB task and idle workers steal them.
+template <unsigned int bitsetSize, typename Sink>
+template <typename Executor>
+void MsBfs<bitsetSize, Sink>::forEachTask(const Executor& executor, PassKind kind)
 {
-    int nodeNumber = countNodes(g);
-    int taskNumber = (nodeNumber > NODE_PER_WORKER) ? (nodeNumber / NODE_PER_WORKER) : 1;
+    profiler.beginPass(kind);
+    if(numaArenas)
+    {
+        // every node runs its own tasks, on its own workers
+        auto body = profiler.timed(executor);
+        numaArenas->run([&] (std::size_t node) {
+            tbb::parallel_for(tbb::blocked_range<size_t>(nodeTasks[node],nodeTasks[node + 1],1),body,tbb::simple_partitioner());
+        });
+    }
+    else
+    {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0,tasks.size(),1),profiler.timed(executor),tbb::simple_partitioner());
+    }
+    profiler.endPass();
+    ++barrierNum;
+}
 
-    std::vector<Node> degreeOrderedNodes;
+template <unsigned int bitsetSize, typename Sink>
+template <typename Executor>
+void MsBfs<bitsetSize, Sink>::forEachEntry(std::size_t size, const Executor& executor, PassKind kind)
+{
+    profiler.beginPass(kind);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0,size,SPARSE_GRAIN),profiler.timed(executor));
+    profiler.endPass();
+    ++barrierNum;
+}
 
-    degreeOrderedNodes.reserve(nodeNumber);
-    tasks.clear();
-    tasks.reserve(taskNumber);
-    
-    getOrderNodesDegree(degreeOrderedNodes);
+template <unsigned int bitsetSize, typename Sink>
+ProfileCounters MsBfs<bitsetSize, Sink>::profileCounters()
+{
+    return ProfileCounters{scannedEdgeNum.load(), checkedEdgeNum.load(), skippedEdgeNum.load(), atomicUpdateNum.load(),
+                           skippedUpdateNum.load(), bufferedUpdateNum.load(), traversedEdgeNum.load()};
+}
 
-    for (int i = 0; i < taskNumber; ++i)
+// A step is one call of the level functions, it is recorded with the level it reports discoveries for.
+// A top-down step over a final frontier (the sources, or a level found bottom-up) only scatters it and
+// reports nothing, it is recorded with the level of that frontier: the sources are level 0.
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::beginStep(const char* direction, std::size_t level)
+{
+    if(EngineProfiler::ENABLED)
     {
-        tasks.emplace_back(MsBfsTask<bitsetSize, std::function<PrintFunctionType<bitsetSize>>>(this, callback));
-    }
-    
-    for (int i = 0; i < nodeNumber; ++i) {
-        tasks[i%taskNumber].addNode(degreeOrderedNodes[i]);
+        profiler.beginStep(direction, firstSource / bitsetSize, level, profileCounters());
     }
 }
 
-template <unsigned int bitsetSize>
-void MsBfs<bitsetSize>::topDownMsPbfs(const std::vector<Node>& sources, std::function<PrintFunctionType<bitsetSize>> callback) 
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::endStep()
 {
-      // during the loop we always use the previous 'next' as the new 'frontier'. To avoid data copying we are simply swapping two maps in each iteration.
-    ListGraph::NodeMap<ParallelLabel> map1(g, std::shared_ptr<std::atomic<int>>()); // we use map1 as the frontier at first
-    ListGraph::NodeMap<ParallelLabel> map2(g, std::shared_ptr<std::atomic<int>>());
-    ListGraph::NodeMap<ParallelLabel> seen_map(g, std::shared_ptr<std::atomic<int>>());
-    
-    for(typename ListGraph::NodeIt v(g); v != INVALID; ++v)
+    if(EngineProfiler::ENABLED)
     {
-        map1[v].reset(new std::atomic<int>(0));
-        map2[v].reset(new std::atomic<int>(0));
-        seen_map[v].reset(new std::atomic<int>(0));
+        profiler.endStep(frontierNodeNum.load(), frontierEdgeNum.load(), profileCounters());
     }
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::initLabels(const std::vector<VertexId>& sources, std::size_t first, std::size_t count)
+{
+    resetLabels();
+    labelClear<WORDS>(allSeenLabel);
+    fullBatch = count == bitsetSize;
 
     ptrFrontier = &map1;
     ptrNext     = &map2;
-    ptrSeen     = &seen_map;
-    foundNewNode.store(true);
+    ptrSeen     = &seenMap;
+    firstSource = first;
     iterationNum = 1;
 
-    initTasks(callback);
-    
-    NeighbourTopDownExecutor<MsBfsTask<bitsetSize, std::function<PrintFunctionType<bitsetSize>>>> neighbourExecutor(tasks);
-    NodeProcessorTopDownExecutor<MsBfsTask<bitsetSize, std::function<PrintFunctionType<bitsetSize>>>> nodeProcessorExecutor(tasks);
-    CleanerExecutor<MsBfsTask<bitsetSize, std::function<PrintFunctionType<bitsetSize>>>> cleanerExecutor(tasks);
-
     // initializing start nodes
-    for(std::size_t i = 0; i < sources.size(); ++i)
+    for(std::size_t i = 0; i < count; ++i)
     {
-        Node s = sources[i];
-        map1[s]->store(1 << i); // set frontier for sources
-        seen_map[s]->store(1 << i); // set seen for sources
+        VertexId s = sources[first + i];
+        labelSet(&map1[s * WORDS], i); // set frontier for sources
+        labelSet(&seenMap[s * WORDS], i); // set seen for sources
+        labelSet(allSeenLabel, i);
     }
-     
-   
-    while(foundNewNode)
+
+    // the sources form a final frontier
+    rawFrontier = false;
+    dirtyNext = false;
+    trackTouched = false;
+    touchedPending = false;
+    touchedList.clear();
+    sink->beginBatch(first, &sources[first], count);
+    frontierList.assign(sources.begin() + first, sources.begin() + first + count);
+    std::sort(frontierList.begin(), frontierList.end());
+    frontierList.truncate(std::unique(frontierList.begin(), frontierList.end()) - frontierList.begin());
+    previousList.clear();
+    visitedList.assign(frontierList.begin(), frontierList.end());
+    labelsClean = false;
+
+    frontierNodeNum.store(frontierList.size());
+    frontierEdgeNum.store(0);
+    unexploredEdgeNum.store(g.edgeNum());
+    for(auto s: frontierList)
     {
-        ptrFrontier = iterationNum % 2 == 1 ? &map1 : &map2;
-        ptrNext     = iterationNum % 2 == 0 ? &map1 : &map2;
-        foundNewNode.store(false);
-        tbb::parallel_for(tbb::blocked_range<size_t>(0,tasks.size()),cleanerExecutor);
-        tbb::parallel_for(tbb::blocked_range<size_t>(0,tasks.size()),neighbourExecutor);
-        tbb::parallel_for(tbb::blocked_range<size_t>(0,tasks.size()),nodeProcessorExecutor);
-        ++iterationNum; 
+        frontierEdgeNum += g.degree(s);
+        if(allSourcesSeen(&seenMap[s * WORDS]))
+        {
+            unexploredEdgeNum -= g.degree(s);
+        }
     }
 }
 
-template <unsigned int bitsetSize>
-void MsBfs<bitsetSize>::bottomUpMsPbfs(const std::vector<Node>& sources, std::function<PrintFunctionType<bitsetSize>> callback) 
+// Wipes what the batch before left in the label arrays. A batch ends with a pass that consumed every raw
+// label and scattered nothing, so only the labels of its frontier vertices can be set (and the touched
+// maps are clean). Unless the batch reached a large part of the graph, clearing those is much cheaper
+// than a sweep over every vertex.
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::resetLabels()
 {
-      // during the loop we always use the previous 'next' as the new 'frontier'. To avoid data copying we are simply swapping two maps in each iteration.
-    ListGraph::NodeMap<ParallelLabel> map1(g, std::shared_ptr<std::atomic<int>>()); // we use map1 as the frontier at first
-    ListGraph::NodeMap<ParallelLabel> map2(g, std::shared_ptr<std::atomic<int>>());
-    ListGraph::NodeMap<ParallelLabel> seen_map(g, std::shared_ptr<std::atomic<int>>());
-    
-    for(typename ListGraph::NodeIt v(g); v != INVALID; ++v)
+    if(labelsClean)
     {
-        map1[v].reset(new std::atomic<int>(0));
-        map2[v].reset(new std::atomic<int>(0));
-        seen_map[v].reset(new std::atomic<int>(0));
+        return;
     }
+    if(visitedList.size() * SPARSE_FRONTIER_DIVISOR < g.nodeNum())
+    {
+        for(VertexId v: visitedList)
+        {
+            labelClear<WORDS>(&map1[v * WORDS]);
+            labelClear<WORDS>(&map2[v * WORDS]);
+            labelClear<WORDS>(&seenMap[v * WORDS]);
+        }
+    }
+    else
+    {
+        std::fill(map1.begin(), map1.end(), 0);
+        std::fill(map2.begin(), map2.end(), 0);
+        std::fill(seenMap.begin(), seenMap.end(), 0);
+        std::fill(touchedMap1.begin(), touchedMap1.end(), 0);
+        std::fill(touchedMap2.begin(), touchedMap2.end(), 0);
+    }
+    visitedList.clear();
+    labelsClean = true;
+}
 
-    ptrFrontier = &map1;
-    ptrNext     = &map2;
-    ptrSeen     = &seen_map;
-    foundNewNode.store(true);
-    iterationNum = 1;
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::topDownMsPbfs(const std::vector<VertexId>& sources, Sink& sink)
+{
+    initTasks(sink);
+    if(EngineProfiler::ENABLED)
+    {
+        profiler.beginRun("top-down", sources.size(), slotNum, profileCounters());
+    }
 
-    initTasks(callback);
-    
-    MsPBfsBottomUpExecutor<MsBfsTask<bitsetSize, std::function<PrintFunctionType<bitsetSize>>>> bottomUpExecutor(tasks);
-    CleanerExecutor<MsBfsTask<bitsetSize, std::function<PrintFunctionType<bitsetSize>>>> cleanerExecutor(tasks);
+    for(std::size_t first = 0; first < sources.size(); first += bitsetSize)
+    {
+        topDownBatch(sources, first, std::min<std::size_t>(bitsetSize, sources.size() - first));
+        sink.endBatch();
+    }
+    if(EngineProfiler::ENABLED)
+    {
+        profiler.endRun(profileCounters());
+    }
+}
 
-    // initializing start nodes
-    for(std::size_t i = 0; i < sources.size(); ++i)
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::topDownBatch(const std::vector<VertexId>& sources, std::size_t first, std::size_t count)
+{
+    initLabels(sources, first, count);
+    std::uint64_t allocations = heapAllocationNum().load();
+
+    // the first pass scatters the sources, every later one finalizes a level; stop when one found nothing
+    do
+    {
+        expandLevel();
+    }
+    while(frontierNodeNum.load() > 0);
+    levelAllocationNum += heapAllocationNum().load() - allocations;
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::resetLevelStats()
+{
+    frontierNodeNum.store(0);
+    frontierEdgeNum.store(0);
+}
+
+// Swaps the touched maps: this pass consumes the one of the scatter before and its own scatter marks the
+// other. A dense pass does not walk the touched list, so it wipes the consumed map as a whole.
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::consumeTouched(bool sparse)
+{
+    std::swap(ptrTouched, ptrConsumed);
+    if(touchedPending && !sparse)
+    {
+        std::fill(ptrConsumed->begin(), ptrConsumed->end(), 0);
+    }
+}
+
+// only needed when a top-down level follows a bottom-up one
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::cleanNext()
+{
+    if(previousList.size() * SPARSE_FRONTIER_DIVISOR < g.nodeNum())
+    {
+        forEachEntry(previousList.size(), SparseCleanerExecutor<MsBfs<bitsetSize, Sink>>(*this), PassKind::Clean);
+    }
+    else
+    {
+        forEachTask(CleanerExecutor<MsBfsTask<bitsetSize, Sink>>(tasks), PassKind::Clean);
+    }
+    dirtyNext = false;
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::endLevel()
+{
+    previousList.swap(frontierList);
+    localFrontiers.gather(frontierList);
+    // once the list stands for a large part of the graph the reset sweeps every vertex anyway
+    if(visitedList.size() * SPARSE_FRONTIER_DIVISOR < g.nodeNum())
+    {
+        visitedList.append(frontierList.begin(), frontierList.end());
+    }
+    sink->endLevel();
+    ++iterationNum;
+    ++levelNum;
+}
+
+// One top-down level in a single pass (plus the hub merge on graphs with hubs). A final frontier is only
+// scattered, a raw one is finalized and scattered.
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::expandLevel()
+{
+    beginStep("top-down", rawFrontier ? iterationNum : iterationNum - 1);
+    bool sparse = rawFrontier ? touchedPending && touchedList.size() * SPARSE_FRONTIER_DIVISOR < g.nodeNum()
+                              : frontierEdgeNum.load() * SPARSE_FRONTIER_DIVISOR < g.nodeNum();
+    // the size of a raw level is only known after the pass, the level before stands in for it
+    trackTouched = frontierEdgeNum.load() * SPARSE_FRONTIER_DIVISOR < g.nodeNum();
+
+    if(dirtyNext)
+    {
+        cleanNext();
+    }
+    consumeTouched(sparse);
+    if(rawFrontier)
+    {
+        resetLevelStats();
+    }
+
+    if(sparse)
+    {
+        ptrActive = rawFrontier ? &touchedList : &frontierList;
+        forEachEntry(ptrActive->size(), SparseScatterExecutor<MsBfs<bitsetSize, Sink>>(*this));
+    }
+    else
+    {
+        prepareSplitNodes();
+        forEachTask(NeighbourTopDownExecutor<MsBfsTask<bitsetSize, Sink>>(tasks));
+    }
+    if(hasHubs())
+    {
+        profiler.beginPass(PassKind::HubMerge);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0,hubs.size()),profiler.timed(HubMergeExecutor<MsBfs<bitsetSize, Sink>>(*this)));
+        profiler.endPass();
+        ++barrierNum;
+    }
+
+    touchedPending = trackTouched;
+    trackTouched = false;
+    localTouched.gather(touchedList);
+    if(rawFrontier)
+    {
+        endLevel();
+    }
+    std::swap(ptrFrontier, ptrNext);
+    rawFrontier = true;
+    endStep();
+}
+
+// finalizes a raw level in place, so that its size is known and the bottom-up kernel can read it
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::finalizeLevel()
+{
+    beginStep("finalize", iterationNum);
+    bool sparse = touchedPending && touchedList.size() * SPARSE_FRONTIER_DIVISOR < g.nodeNum();
+
+    consumeTouched(sparse);
+    resetLevelStats();
+    if(sparse)
+    {
+        forEachEntry(touchedList.size(), SparseProcessorExecutor<MsBfs<bitsetSize, Sink>>(*this));
+    }
+    else
+    {
+        forEachTask(NodeProcessorTopDownExecutor<MsBfsTask<bitsetSize, Sink>>(tasks));
+    }
+
+    touchedPending = false;
+    touchedList.clear();
+    endLevel();
+    rawFrontier = false;
+    endStep();
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::bottomUpMsPbfs(const std::vector<VertexId>& sources, Sink& sink)
+{
+    initTasks(sink);
+    if(EngineProfiler::ENABLED)
+    {
+        profiler.beginRun("bottom-up", sources.size(), slotNum, profileCounters());
+    }
+
+    for(std::size_t first = 0; first < sources.size(); first += bitsetSize)
     {
-        Node s = sources[i];
-        map1[s]->store(1 << i); // set frontier for sources
-        seen_map[s]->store(1 << i); // set seen for sources
+        bottomUpBatch(sources, first, std::min<std::size_t>(bitsetSize, sources.size() - first));
+        sink.endBatch();
     }
-     
-   
-    while(foundNewNode)
+    if(EngineProfiler::ENABLED)
     {
-        ptrFrontier = iterationNum % 2 == 1 ? &map1 : &map2;
-        ptrNext     = iterationNum % 2 == 0 ? &map1 : &map2;
-        foundNewNode.store(false);
-        tbb::parallel_for(tbb::blocked_range<size_t>(0,tasks.size()),cleanerExecutor);
-        tbb::parallel_for(tbb::blocked_range<size_t>(0,tasks.size()),bottomUpExecutor);
-        ++iterationNum; 
+        profiler.endRun(profileCounters());
     }
 }
 
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::bottomUpBatch(const std::vector<VertexId>& sources, std::size_t first, std::size_t count)
+{
+    initLabels(sources, first, count);
+    std::uint64_t allocations = heapAllocationNum().load();
+
+    while(frontierNodeNum.load() > 0)
+    {
+        bottomUpLevel();
+    }
+    levelAllocationNum += heapAllocationNum().load() - allocations;
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::bottomUpLevel()
+{
+    beginStep("bottom-up", iterationNum);
+    resetLevelStats();
+    forEachTask(MsPBfsBottomUpExecutor<MsBfsTask<bitsetSize, Sink>>(tasks));
+    endLevel();
+    std::swap(ptrFrontier, ptrNext);
+    dirtyNext = true;
+    endStep();
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::hybridMsPbfs(const std::vector<VertexId>& sources, Sink& sink,
+                                           double alpha, double beta)
+{
+    initTasks(sink);
+    if(EngineProfiler::ENABLED)
+    {
+        profiler.beginRun("hybrid", sources.size(), slotNum, profileCounters());
+    }
 
-template <unsigned int bitsetSize>
-void MsBfs<bitsetSize>::foundNew() {
-    foundNewNode.store(true);   
+    for(std::size_t first = 0; first < sources.size(); first += bitsetSize)
+    {
+        hybridBatch(sources, first, std::min<std::size_t>(bitsetSize, sources.size() - first), alpha, beta);
+        sink.endBatch();
+    }
+    if(EngineProfiler::ENABLED)
+    {
+        profiler.endRun(profileCounters());
+    }
 }
 
-template <unsigned int bitsetSize>
-const ListGraph& MsBfs<bitsetSize>::getGraph()
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::hybridBatch(const std::vector<VertexId>& sources, std::size_t first, std::size_t count, double alpha, double beta)
+{
+    initLabels(sources, first, count);
+    std::uint64_t allocations = heapAllocationNum().load();
+    bool bottomUp = false;
+
+    while(frontierNodeNum.load() > 0)
+    {
+        if(rawFrontier)
+        {
+            // The size of a raw level is not known yet. When the level before already calls for bottom-up,
+            // finalize it first and decide on the exact numbers, otherwise keep going top-down.
+            if(frontierEdgeNum.load() > unexploredEdgeNum.load() / alpha)
+            {
+                finalizeLevel();
+            }
+            else
+            {
+                expandLevel();
+            }
+            continue;
+        }
+
+        if(!bottomUp && frontierEdgeNum.load() > unexploredEdgeNum.load() / alpha)
+        {
+            bottomUp = true;
+        }
+        else if(bottomUp && frontierNodeNum.load() < g.nodeNum() / beta)
+        {
+            bottomUp = false;
+        }
+
+        if(bottomUp)
+        {
+            bottomUpLevel();
+        }
+        else
+        {
+            expandLevel();
+        }
+    }
+    levelAllocationNum += heapAllocationNum().load() - allocations;
+}
+
+
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::addLevelStats(const LevelStats& stats) {
+    frontierNodeNum += stats.frontierNodes;
+    frontierEdgeNum += stats.frontierEdges;
+    unexploredEdgeNum -= stats.exploredEdges;
+    if(stats.checkedEdges > 0)
+    {
+        checkedEdgeNum += stats.checkedEdges;
+        skippedEdgeNum += stats.skippedEdges;
+    }
+    if(stats.traversedEdges > 0)
+    {
+        traversedEdgeNum += stats.traversedEdges;
+    }
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::addScatterStats(const ScatterStats& stats) {
+    atomicUpdateNum += stats.atomicUpdates;
+    skippedUpdateNum += stats.skippedUpdates;
+    bufferedUpdateNum += stats.bufferedUpdates;
+    scannedEdgeNum += stats.scannedEdges;
+}
+
+template <unsigned int bitsetSize, typename Sink>
+ScatterStats MsBfs<bitsetSize, Sink>::getScatterStats() {
+    return ScatterStats{atomicUpdateNum.load(), skippedUpdateNum.load(), bufferedUpdateNum.load(), scannedEdgeNum.load()};
+}
+
+template <unsigned int bitsetSize, typename Sink>
+BottomUpStats MsBfs<bitsetSize, Sink>::getBottomUpStats() {
+    return BottomUpStats{checkedEdgeNum.load(), skippedEdgeNum.load()};
+}
+
+template <unsigned int bitsetSize, typename Sink>
+EngineProfiler& MsBfs<bitsetSize, Sink>::getProfiler() {
+    return profiler;
+}
+
+template <unsigned int bitsetSize, typename Sink>
+std::size_t MsBfs<bitsetSize, Sink>::getLevelNum() {
+    return levelNum;
+}
+
+template <unsigned int bitsetSize, typename Sink>
+std::size_t MsBfs<bitsetSize, Sink>::getBarrierNum() {
+    return barrierNum;
+}
+
+template <unsigned int bitsetSize, typename Sink>
+bool MsBfs<bitsetSize, Sink>::hasHubs() {
+    return !hubs.empty();
+}
+
+template <unsigned int bitsetSize, typename Sink>
+ParallelLabel* MsBfs<bitsetSize, Sink>::localHubBuffer() {
+    std::size_t slot = workerSlot();
+    if(!hubBuffersUsed[slot])
+    {
+        hubBuffersUsed[slot] = true;
+    }
+    return hubBuffers + slot * hubBufferStride(hubs.size());
+}
+
+template <unsigned int bitsetSize, typename Sink>
+VertexAppender& MsBfs<bitsetSize, Sink>::localFrontier() {
+    return localFrontiers.appender(workerSlot());
+}
+
+template <unsigned int bitsetSize, typename Sink>
+VertexAppender* MsBfs<bitsetSize, Sink>::localTouchedList() {
+    return trackTouched ? &localTouched.appender(workerSlot()) : nullptr;
+}
+
+// ORs the thread-local updates of hubs [begin, end) into 'next' and clears the buffers for the next level
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::mergeHubBuffers(std::size_t begin, std::size_t end) {
+    auto& next = *ptrNext;
+    for(std::size_t slot = 0; slot < slotNum; ++slot)
+    {
+        if(!hubBuffersUsed[slot])
+        {
+            continue;
+        }
+        ParallelLabel* buffer = hubBuffers + slot * hubBufferStride(hubs.size());
+        for(std::size_t h = begin; h < end; ++h)
+        {
+            labelOr<WORDS>(&next[hubs[h] * WORDS], &buffer[h * WORDS]);
+            labelClear<WORDS>(&buffer[h * WORDS]);
+        }
+    }
+    VertexAppender* touched = localTouchedList();
+    if(touched)
+    {
+        for(std::size_t h = begin; h < end; ++h)
+        {
+            if(!labelIsZero<WORDS>(&next[hubs[h] * WORDS]))
+            {
+                touch(hubs[h], *touched);
+            }
+        }
+    }
+}
+
+template <unsigned int bitsetSize, typename Sink>
+const CsrGraph& MsBfs<bitsetSize, Sink>::getGraph()
 {
     return g;
 }
 
-template <unsigned int bitsetSize>
-std::size_t MsBfs<bitsetSize>::getIterationNum()
+template <unsigned int bitsetSize, typename Sink>
+std::size_t MsBfs<bitsetSize, Sink>::getIterationNum()
 {
     return iterationNum;
 }
 
-template <unsigned int bitsetSize>
-ListGraph::NodeMap<ParallelLabel>& MsBfs<bitsetSize>::seen() {
+template <unsigned int bitsetSize, typename Sink>
+std::size_t MsBfs<bitsetSize, Sink>::getFirstSource()
+{
+    return firstSource;
+}
+
+template <unsigned int bitsetSize, typename Sink>
+std::size_t MsBfs<bitsetSize, Sink>::arenaBytes()
+{
+    return runArena.reservedBytes();
+}
+
+template <unsigned int bitsetSize, typename Sink>
+std::uint64_t MsBfs<bitsetSize, Sink>::getLevelAllocations()
+{
+    return levelAllocationNum;
+}
+
+// the labels are wiped first, the visited list that tells which ones to wipe lives in the arena
+template <unsigned int bitsetSize, typename Sink>
+void MsBfs<bitsetSize, Sink>::releaseRunMemory()
+{
+    resetLabels();
+    runArena.discard();
+    initRunState();
+}
+
+template <unsigned int bitsetSize, typename Sink>
+NumaPlacement MsBfs<bitsetSize, Sink>::getPlacement()
+{
+    return placement;
+}
+
+template <unsigned int bitsetSize, typename Sink>
+std::size_t MsBfs<bitsetSize, Sink>::placedBytes()
+{
+    return placedByteNum;
+}
+
+template <unsigned int bitsetSize, typename Sink>
+LabelArray& MsBfs<bitsetSize, Sink>::seen() {
     return *ptrSeen;
 }
 
-template <unsigned int bitsetSize>
-ListGraph::NodeMap<ParallelLabel>& MsBfs<bitsetSize>::frontier() {
+template <unsigned int bitsetSize, typename Sink>
+LabelArray& MsBfs<bitsetSize, Sink>::frontier() {
     return *ptrFrontier;
 }
 
-template <unsigned int bitsetSize>
-ListGraph::NodeMap<ParallelLabel>& MsBfs<bitsetSize>::next() {
+template <unsigned int bitsetSize, typename Sink>
+LabelArray& MsBfs<bitsetSize, Sink>::next() {
     return *ptrNext;
 }
 
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,285 @@
+#ifndef NUMAPLACEMENT_H
+#define NUMAPLACEMENT_H
+
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "tbb/task_arena.h"
+#include "tbb/task_group.h"
+#include "tbb/task_scheduler_observer.h"
+
+#include "Profile.h"
+
+// Placement of the label arrays and the adjacency of an engine on the memory nodes of the machine.
+//
+//   Naive        everything lives where the thread that built it ran, usually one node, and any worker
+//                runs any task (the default, as on a single socket)
+//   Local        the tasks are cut into one contiguous group per node, the labels and adjacency of a
+//                group are bound to its node and only workers pinned to that node run its tasks
+//   Interleaved  the pages are spread round robin over every node, any worker runs any task; no
+//                locality, but no single memory controller takes all the traffic either
+//
+// The topology comes from sysfs and the pages are placed with mbind, so nothing beyond the kernel is
+// needed. Where the kernel refuses (no NUMA support, sandboxes), the pages stay where they are and
+// placedBytes() of the engine tells so. Pages of a mapped graph file belong to the page cache and may
+// not move either.
+
+enum class NumaPlacement
+{
+    Naive,
+    Local,
+    Interleaved
+};
+
+inline const char* numaPlacementName(NumaPlacement placement)
+{
+    switch(placement)
+    {
+        case NumaPlacement::Naive: return "naive";
+        case NumaPlacement::Local: return "local";
+        case NumaPlacement::Interleaved: return "interleaved";
+    }
+    return "unknown";
+}
+
+inline NumaPlacement parseNumaPlacement(const std::string& name)
+{
+    for(NumaPlacement placement: {NumaPlacement::Naive, NumaPlacement::Local, NumaPlacement::Interleaved})
+    {
+        if(name == numaPlacementName(placement))
+        {
+            return placement;
+        }
+    }
+    throw std::runtime_error("unknown placement " + name + " (naive, local or interleaved)");
+}
+
+// parses a sysfs cpu or node list such as "0-3,8-11"
+inline std::vector<int> parseIdList(const std::string& list)
+{
+    std::vector<int> ids;
+    std::istringstream stream(list);
+    std::string range;
+    while(std::getline(stream, range, ','))
+    {
+        if(range.empty() || range == "\n")
+        {
+            continue;
+        }
+        std::size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for(int id = first; id <= last; ++id)
+        {
+            ids.push_back(id);
+        }
+    }
+    return ids;
+}
+
+struct NumaNode
+{
+    int id;
+    std::vector<int> cpus;
+};
+
+// The memory nodes with cpus. Without sysfs, one node 0 with every cpu the process may run on.
+inline const std::vector<NumaNode>& numaNodes()
+{
+    static const std::vector<NumaNode> nodes = [] {
+        std::vector<NumaNode> result;
+        std::ifstream online("/sys/devices/system/node/online");
+        std::string list;
+        if(std::getline(online, list))
+        {
+            for(int id: parseIdList(list))
+            {
+                std::ifstream cpuFile("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+                std::string cpus;
+                if(std::getline(cpuFile, cpus) && !parseIdList(cpus).empty())
+                {
+                    result.push_back(NumaNode{id, parseIdList(cpus)});
+                }
+            }
+        }
+        if(result.empty())
+        {
+            cpu_set_t mask;
+            CPU_ZERO(&mask);
+            sched_getaffinity(0, sizeof(mask), &mask);
+            result.push_back(NumaNode{0, {}});
+            for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            {
+                if(CPU_ISSET(cpu, &mask))
+                {
+                    result.back().cpus.push_back(cpu);
+                }
+            }
+        }
+        return result;
+    }();
+    return nodes;
+}
+
+// Binds the whole pages of [begin, begin + bytes) to a node, or interleaves them over every node if
+// node is negative, and migrates the pages that are already there. The pages at the ends are shared
+// with the neighbouring ranges and left alone. Returns the bytes placed, 0 if the kernel refused.
+inline std::size_t placeMemory(const void* begin, std::size_t bytes, int node)
+{
+    static const std::uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+    std::uintptr_t first = (reinterpret_cast<std::uintptr_t>(begin) + pageSize - 1) / pageSize * pageSize;
+    std::uintptr_t last = (reinterpret_cast<std::uintptr_t>(begin) + bytes) / pageSize * pageSize;
+    if(bytes == 0 || last <= first)
+    {
+        return 0;
+    }
+
+    const std::size_t maskBits = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> mask(1);
+    auto addNode = [&] (int id) {
+        if(std::size_t(id) / maskBits >= mask.size())
+        {
+            mask.resize(id / maskBits + 1, 0);
+        }
+        mask[id / maskBits] |= 1UL << (id % maskBits);
+    };
+    if(node >= 0)
+    {
+        addNode(node);
+    }
+    else
+    {
+        for(const NumaNode& n: numaNodes())
+        {
+            addNode(n.id);
+        }
+    }
+    long result = syscall(SYS_mbind, first, last - first, node >= 0 ? MPOL_BIND : MPOL_INTERLEAVE, mask.data(),
+                          mask.size() * maskBits + 1, MPOL_MF_MOVE);
+    return result == 0 ? last - first : 0;
+}
+
+// One task arena per memory node, whose workers are pinned to the cpus of that node while they are in
+// it. The threads are shared out in proportion to the cpus of the nodes, every arena gets at least one
+// and with fewer threads than nodes only the first nodes are used.
+class NumaArenas
+{
+public:
+    NumaArenas(int threadNumber);
+
+    std::size_t size() const;
+    const NumaNode& node(std::size_t i) const;
+    // runs f(i) in arena i for every arena at once and waits for all of them
+    template <typename Function>
+    void run(Function f);
+private:
+    class PinningObserver: public tbb::task_scheduler_observer
+    {
+    public:
+        PinningObserver(tbb::task_arena& arena, const NumaNode& node, int slotBase_);
+        void on_scheduler_entry(bool) override;
+        void on_scheduler_exit(bool) override;
+    private:
+        cpu_set_t nodeMask;
+        int slotBase;
+    };
+
+    std::vector<const NumaNode*> nodes;
+    std::vector<std::unique_ptr<tbb::task_arena>> arenas;
+    std::vector<std::unique_ptr<PinningObserver>> observers;
+    std::vector<std::unique_ptr<tbb::task_group>> groups;
+};
+
+inline NumaArenas::PinningObserver::PinningObserver(tbb::task_arena& arena, const NumaNode& node, int slotBase_):
+    tbb::task_scheduler_observer(arena), slotBase(slotBase_)
+{
+    CPU_ZERO(&nodeMask);
+    for(int cpu: node.cpus)
+    {
+        CPU_SET(cpu, &nodeMask);
+    }
+    observe(true);
+}
+
+// mask of a thread from before it entered a node arena
+inline cpu_set_t& savedThreadMask()
+{
+    static thread_local cpu_set_t mask;
+    return mask;
+}
+
+// Threads leave with the mask they came with, workers move on to other arenas and the calling thread
+// of run() enters the node arenas as well.
+inline void NumaArenas::PinningObserver::on_scheduler_entry(bool)
+{
+    sched_getaffinity(0, sizeof(cpu_set_t), &savedThreadMask());
+    sched_setaffinity(0, sizeof(nodeMask), &nodeMask);
+    profileSlotBase() = slotBase;
+}
+
+inline void NumaArenas::PinningObserver::on_scheduler_exit(bool)
+{
+    sched_setaffinity(0, sizeof(cpu_set_t), &savedThreadMask());
+    profileSlotBase() = 0;
+}
+
+inline NumaArenas::NumaArenas(int threadNumber)
+{
+    const std::vector<NumaNode>& all = numaNodes();
+    std::size_t used = std::min<std::size_t>(all.size(), std::max(1, threadNumber));
+    std::size_t cpuNumber = 0;
+    for(std::size_t i = 0; i < used; ++i)
+    {
+        cpuNumber += all[i].cpus.size();
+    }
+    int assigned = 0;
+    int slotBase = 0;
+    for(std::size_t i = 0; i < used; ++i)
+    {
+        // the last arena takes the rounding remainder
+        int threads = i + 1 == used ? std::max(1, threadNumber - assigned)
+                                    : std::max<int>(1, threadNumber * all[i].cpus.size() / cpuNumber);
+        assigned += threads;
+        nodes.push_back(&all[i]);
+        // the calling thread of run() waits in the first arena and takes a slot there
+        arenas.emplace_back(new tbb::task_arena(threads, i == 0 ? 1 : 0));
+        arenas.back()->initialize();
+        observers.emplace_back(new PinningObserver(*arenas.back(), all[i], slotBase));
+        groups.emplace_back(new tbb::task_group());
+        slotBase += threads;
+    }
+}
+
+inline std::size_t NumaArenas::size() const
+{
+    return arenas.size();
+}
+
+inline const NumaNode& NumaArenas::node(std::size_t i) const
+{
+    return *nodes[i];
+}
+
+template <typename Function>
+void NumaArenas::run(Function f)
+{
+    for(std::size_t i = 0; i < arenas.size(); ++i)
+    {
+        arenas[i]->execute([&, i] {groups[i]->run([&f, i] {f(i);});});
+    }
+    for(std::size_t i = 0; i < arenas.size(); ++i)
+    {
+        arenas[i]->execute([&, i] {groups[i]->wait();});
+    }
+}
+
+#endif
@@ -0,0 +1,395 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "tbb/blocked_range.h"
+#include "tbb/task_arena.h"
+
+#include "Types.h"
+
+// Per-level instrumentation of MsBfs. An engine built with -DMSBFS_PROFILE (make PROFILE=1) records
+// every step of a run (a top-down pass, the finalizing pass before the hybrid goes bottom-up, or a
+// bottom-up pass) with its counters and the timing of its parallel passes, plus the busy time of every
+// worker. Without the flag the engine uses NullProfiler: its hooks are guarded by the constexpr
+// ENABLED and the task bodies are passed on unwrapped, so nothing of this ends up in the kernels.
+//
+// TEPS counts, like the MS-BFS papers, the edges of every vertex once per source that reached it
+// (degree times the number of sources in its label), divided by the run time.
+
+enum class PassKind
+{
+    Tasks,   // a sweep over the vertex partitions
+    Entries, // a pass over a sparse frontier or touched list
+    HubMerge,
+    Clean
+};
+
+inline const char* passKindName(PassKind kind)
+{
+    switch(kind)
+    {
+        case PassKind::Tasks: return "tasks";
+        case PassKind::Entries: return "entries";
+        case PassKind::HubMerge: return "hub-merge";
+        case PassKind::Clean: return "clean";
+    }
+    return "unknown";
+}
+
+// running totals of the engine, a step records the difference between its end and its start
+struct ProfileCounters
+{
+    std::uint64_t scannedEdges;    // top-down: adjacency entries scattered
+    std::uint64_t checkedEdges;    // bottom-up: adjacency entries read
+    std::uint64_t earlyExitEdges;  // bottom-up: entries skipped once every missing source was found
+    std::uint64_t atomicUpdates;
+    std::uint64_t skippedUpdates;
+    std::uint64_t bufferedUpdates;
+    std::uint64_t traversedEdges;  // degree times sources, see TEPS above
+};
+
+struct PassProfile
+{
+    PassKind kind;
+    std::size_t bodies;        // task bodies run, one per partition or per chunk of a list
+    double seconds;
+    double maxBodySeconds;
+    double meanBodySeconds;
+
+    // slowest body over the average one, 1 is perfect balance
+    double imbalance() const
+    {
+        return meanBodySeconds > 0 ? maxBodySeconds / meanBodySeconds : 1;
+    }
+};
+
+struct StepProfile
+{
+    std::size_t batch;
+    std::size_t level;
+    std::string direction;
+    double seconds;
+    std::size_t frontierNodes; // size of the frontier after the step
+    EdgeIndex frontierEdges;
+    ProfileCounters counters;
+    std::vector<PassProfile> passes;
+};
+
+struct WorkerProfile
+{
+    double busySeconds;
+    std::uint64_t bodies;
+};
+
+struct RunProfile
+{
+    std::string mode;
+    std::size_t sources;
+    double seconds;
+    ProfileCounters counters;
+    std::vector<StepProfile> steps;
+    std::vector<WorkerProfile> workers;
+
+    double teps() const
+    {
+        return seconds > 0 ? counters.traversedEdges / seconds : 0;
+    }
+};
+
+inline ProfileCounters operator-(const ProfileCounters& lhs, const ProfileCounters& rhs)
+{
+    return ProfileCounters{lhs.scannedEdges - rhs.scannedEdges, lhs.checkedEdges - rhs.checkedEdges,
+                           lhs.earlyExitEdges - rhs.earlyExitEdges, lhs.atomicUpdates - rhs.atomicUpdates,
+                           lhs.skippedUpdates - rhs.skippedUpdates, lhs.bufferedUpdates - rhs.bufferedUpdates,
+                           lhs.traversedEdges - rhs.traversedEdges};
+}
+
+class NullProfiler
+{
+public:
+    static constexpr bool ENABLED = false;
+
+    void beginRun(const char*, std::size_t, std::size_t, const ProfileCounters&) {}
+    void endRun(const ProfileCounters&) {}
+    void beginStep(const char*, std::size_t, std::size_t, const ProfileCounters&) {}
+    void endStep(std::size_t, EdgeIndex, const ProfileCounters&) {}
+    void beginPass(PassKind) {}
+    void endPass() {}
+
+    template <typename Executor>
+    const Executor& timed(const Executor& executor)
+    {
+        return executor;
+    }
+};
+
+class LevelProfiler;
+
+// First worker slot of the arena the calling thread runs in. A run spread over several arenas gives each
+// of them its own range of slots (see NumaPlacement.h), otherwise the slot is the arena index.
+inline int& profileSlotBase()
+{
+    static thread_local int base = 0;
+    return base;
+}
+
+// runs a task body and charges its time to the worker that ran it
+template <typename Executor>
+struct TimedExecutor
+{
+    TimedExecutor(const Executor& e, LevelProfiler& p):executor(e), profiler(p)
+    {}
+
+    void operator()(const tbb::blocked_range<size_t>& r) const;
+
+    const Executor& executor;
+    LevelProfiler& profiler;
+};
+
+class LevelProfiler
+{
+public:
+    static constexpr bool ENABLED = true;
+    typedef std::chrono::steady_clock Clock;
+
+    // slotNum has to cover every worker that runs a pass, the engine passes its own (see MsBfs::workerSlot)
+    void beginRun(const char* mode, std::size_t sources, std::size_t slotNum, const ProfileCounters& counters);
+    void endRun(const ProfileCounters& counters);
+    void beginStep(const char* direction, std::size_t batch, std::size_t level, const ProfileCounters& counters);
+    void endStep(std::size_t frontierNodes, EdgeIndex frontierEdges, const ProfileCounters& counters);
+    void beginPass(PassKind kind);
+    void endPass();
+
+    template <typename Executor>
+    TimedExecutor<Executor> timed(const Executor& executor)
+    {
+        return TimedExecutor<Executor>(executor, *this);
+    }
+    // from the workers, every worker only writes its own slot
+    void recordBody(double seconds);
+
+    const std::vector<RunProfile>& getRuns() const;
+    void clear();
+    // one object per run with its steps, passes and workers
+    void writeJson(std::ostream& out) const;
+    // one row per step, the passes of a step are summed up (workers are only in the JSON output)
+    void writeCsv(std::ostream& out) const;
+private:
+    // a cache line per worker
+    struct alignas(64) WorkerSlot
+    {
+        double busySeconds;
+        std::uint64_t bodies;
+        double passSeconds;
+        double passMaxSeconds;
+        std::uint64_t passBodies;
+    };
+    std::vector<RunProfile> runs;
+    std::vector<WorkerSlot> slots;
+    Clock::time_point runStart;
+    Clock::time_point stepStart;
+    Clock::time_point passStart;
+    ProfileCounters runCounters;
+    ProfileCounters stepCounters;
+    PassKind passKind;
+};
+
+template <typename Executor>
+void TimedExecutor<Executor>::operator()(const tbb::blocked_range<size_t>& r) const
+{
+    LevelProfiler::Clock::time_point start = LevelProfiler::Clock::now();
+    executor(r);
+    profiler.recordBody(std::chrono::duration<double>(LevelProfiler::Clock::now() - start).count());
+}
+
+inline void LevelProfiler::beginRun(const char* mode, std::size_t sources, std::size_t slotNum, const ProfileCounters& counters)
+{
+    runs.push_back(RunProfile{mode, sources, 0, ProfileCounters(), {}, {}});
+    slots.assign(slotNum, WorkerSlot{0, 0, 0, 0, 0});
+    runCounters = counters;
+    runStart = Clock::now();
+}
+
+inline void LevelProfiler::endRun(const ProfileCounters& counters)
+{
+    RunProfile& run = runs.back();
+    run.seconds = std::chrono::duration<double>(Clock::now() - runStart).count();
+    run.counters = counters - runCounters;
+    for(const WorkerSlot& slot: slots)
+    {
+        run.workers.push_back(WorkerProfile{slot.busySeconds, slot.bodies});
+    }
+}
+
+inline void LevelProfiler::beginStep(const char* direction, std::size_t batch, std::size_t level, const ProfileCounters& counters)
+{
+    runs.back().steps.push_back(StepProfile{batch, level, direction, 0, 0, 0, ProfileCounters(), {}});
+    stepCounters = counters;
+    stepStart = Clock::now();
+}
+
+inline void LevelProfiler::endStep(std::size_t frontierNodes, EdgeIndex frontierEdges, const ProfileCounters& counters)
+{
+    StepProfile& step = runs.back().steps.back();
+    step.seconds = std::chrono::duration<double>(Clock::now() - stepStart).count();
+    step.frontierNodes = frontierNodes;
+    step.frontierEdges = frontierEdges;
+    step.counters = counters - stepCounters;
+}
+
+inline void LevelProfiler::beginPass(PassKind kind)
+{
+    passKind = kind;
+    passStart = Clock::now();
+}
+
+inline void LevelProfiler::endPass()
+{
+    PassProfile pass = {passKind, 0, std::chrono::duration<double>(Clock::now() - passStart).count(), 0, 0};
+    double bodySeconds = 0;
+    for(WorkerSlot& slot: slots)
+    {
+        pass.bodies += slot.passBodies;
+        pass.maxBodySeconds = std::max(pass.maxBodySeconds, slot.passMaxSeconds);
+        bodySeconds += slot.passSeconds;
+        slot.passSeconds = 0;
+        slot.passMaxSeconds = 0;
+        slot.passBodies = 0;
+    }
+    pass.meanBodySeconds = pass.bodies > 0 ? bodySeconds / pass.bodies : 0;
+    // passes outside of a step (none so far) are only counted in the worker times
+    if(!runs.empty() && !runs.back().steps.empty())
+    {
+        runs.back().steps.back().passes.push_back(pass);
+    }
+}
+
+inline void LevelProfiler::recordBody(double seconds)
+{
+    int index = profileSlotBase() + tbb::this_task_arena::current_thread_index();
+    assert(index >= 0 && std::size_t(index) < slots.size());
+    WorkerSlot& slot = slots[index];
+    slot.busySeconds += seconds;
+    ++slot.bodies;
+    slot.passSeconds += seconds;
+    slot.passMaxSeconds = std::max(slot.passMaxSeconds, seconds);
+    ++slot.passBodies;
+}
+
+inline const std::vector<RunProfile>& LevelProfiler::getRuns() const
+{
+    return runs;
+}
+
+inline void LevelProfiler::clear()
+{
+    runs.clear();
+}
+
+inline void writeProfileCounters(std::ostream& out, const ProfileCounters& c)
+{
+    out << "\"scannedEdges\": " << c.scannedEdges << ", \"checkedEdges\": " << c.checkedEdges
+        << ", \"earlyExitEdges\": " << c.earlyExitEdges << ", \"atomicUpdates\": " << c.atomicUpdates
+        << ", \"skippedUpdates\": " << c.skippedUpdates << ", \"bufferedUpdates\": " << c.bufferedUpdates
+        << ", \"traversedEdges\": " << c.traversedEdges;
+}
+
+inline void LevelProfiler::writeJson(std::ostream& out) const
+{
+    out << "{\"runs\": [";
+    for(std::size_t r = 0; r < runs.size(); ++r)
+    {
+        const RunProfile& run = runs[r];
+        out << (r ? ",\n" : "\n") << "  {\"mode\": \"" << run.mode << "\", \"sources\": " << run.sources
+            << ", \"seconds\": " << run.seconds << ", \"teps\": " << run.teps() << ", ";
+        writeProfileCounters(out, run.counters);
+        out << ",\n   \"steps\": [";
+        for(std::size_t s = 0; s < run.steps.size(); ++s)
+        {
+            const StepProfile& step = run.steps[s];
+            out << (s ? ",\n" : "\n") << "    {\"batch\": " << step.batch << ", \"level\": " << step.level
+                << ", \"direction\": \"" << step.direction << "\", \"seconds\": " << step.seconds
+                << ", \"frontierNodes\": " << step.frontierNodes << ", \"frontierEdges\": " << step.frontierEdges << ", ";
+            writeProfileCounters(out, step.counters);
+            out << ", \"passes\": [";
+            for(std::size_t p = 0; p < step.passes.size(); ++p)
+            {
+                const PassProfile& pass = step.passes[p];
+                out << (p ? ", " : "") << "{\"kind\": \"" << passKindName(pass.kind) << "\", \"bodies\": " << pass.bodies
+                    << ", \"seconds\": " << pass.seconds << ", \"maxBodySeconds\": " << pass.maxBodySeconds
+                    << ", \"meanBodySeconds\": " << pass.meanBodySeconds << ", \"imbalance\": " << pass.imbalance() << "}";
+            }
+            out << "]}";
+        }
+        out << "],\n   \"workers\": [";
+        for(std::size_t w = 0; w < run.workers.size(); ++w)
+        {
+            out << (w ? ", " : "") << "{\"busySeconds\": " << run.workers[w].busySeconds << ", \"bodies\": " << run.workers[w].bodies << "}";
+        }
+        out << "]}";
+    }
+    out << "\n]}" << std::endl;
+}
+
+inline void LevelProfiler::writeCsv(std::ostream& out) const
+{
+    out << "run,mode,batch,level,direction,seconds,frontierNodes,frontierEdges,scannedEdges,checkedEdges,earlyExitEdges,"
+           "atomicUpdates,skippedUpdates,bufferedUpdates,traversedEdges,passes,passSeconds,maxImbalance,runTeps\n";
+    for(std::size_t r = 0; r < runs.size(); ++r)
+    {
+        const RunProfile& run = runs[r];
+        for(const StepProfile& step: run.steps)
+        {
+            double passSeconds = 0;
+            double maxImbalance = 1;
+            for(const PassProfile& pass: step.passes)
+            {
+                passSeconds += pass.seconds;
+                maxImbalance = std::max(maxImbalance, pass.imbalance());
+            }
+            const ProfileCounters& c = step.counters;
+            out << r << ',' << run.mode << ',' << step.batch << ',' << step.level << ',' << step.direction << ','
+                << step.seconds << ',' << step.frontierNodes << ',' << step.frontierEdges << ','
+                << c.scannedEdges << ',' << c.checkedEdges << ',' << c.earlyExitEdges << ',' << c.atomicUpdates << ','
+                << c.skippedUpdates << ',' << c.bufferedUpdates << ',' << c.traversedEdges << ','
+                << step.passes.size() << ',' << passSeconds << ',' << maxImbalance << ',' << run.teps() << '\n';
+        }
+    }
+}
+
+// writes the records as CSV if the path ends in .csv and as JSON otherwise
+inline void writeProfile(const LevelProfiler& profiler, const std::string& path)
+{
+    std::ofstream out(path);
+    if(!out)
+    {
+        throw std::runtime_error("cannot create " + path);
+    }
+    if(path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0)
+    {
+        profiler.writeCsv(out);
+    }
+    else
+    {
+        profiler.writeJson(out);
+    }
+}
+
+inline void writeProfile(const NullProfiler&, const std::string&)
+{}
+
+#ifdef MSBFS_PROFILE
+typedef LevelProfiler EngineProfiler;
+#else
+typedef NullProfiler EngineProfiler;
+#endif
+
+#endif
@@ -0,0 +1,517 @@
+#ifndef QUERYSERVER_H
+#define QUERYSERVER_H
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "MsPbfs.h"
+
+// Long-running query mode: single-source queries arrive one at a time (from stdin or a Unix socket) and
+// are coalesced into MS-BFS batches. A batch is started once it has bitsetSize distinct sources or once
+// the oldest waiting query has waited for the batching window, whichever comes first. A longer window
+// fills the batches better and raises the throughput at the cost of latency.
+//
+// Protocol, one request per line, ids are the ids of the input graph:
+//
+//   dist <source> <target>    -> "dist <source> <target> <distance>", -1 if unreachable
+//   reach <source> <target>   -> "reach <source> <target> <0|1>"
+//   stats                     -> "stats queries <n> batches <n> sources/batch <x> p50 <ms> p99 <ms> qps <x>"
+//   shutdown                  -> answers what is queued, then stops the server; queries that come
+//                                after it are answered with an error
+//
+// A connection gets the answers to its queries in the order of the queries. Malformed requests and
+// stats are answered right away, ahead of queries that are still waiting for their batch.
+
+// where the answers of a client go, shared by all its queries
+class QueryConnection
+{
+public:
+    QueryConnection(int fd_, bool ownsFd_): fd(fd_), ownsFd(ownsFd_) {}
+    ~QueryConnection()
+    {
+        if(ownsFd)
+        {
+            close(fd);
+        }
+    }
+    QueryConnection(const QueryConnection&) = delete;
+    QueryConnection& operator=(const QueryConnection&) = delete;
+
+    // A client that hung up must not take the server down: sockets are written without SIGPIPE, other
+    // descriptors (stdout) fall back to write().
+    void reply(const std::string& line)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::string text = line + '\n';
+        for(std::size_t written = 0; written < text.size();)
+        {
+            ssize_t n = send(fd, text.data() + written, text.size() - written, MSG_NOSIGNAL);
+            if(n < 0 && errno == ENOTSOCK)
+            {
+                n = write(fd, text.data() + written, text.size() - written);
+            }
+            if(n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if(n <= 0)
+            {
+                return; // the client is gone
+            }
+            written += n;
+        }
+    }
+private:
+    int fd;
+    bool ownsFd;
+    std::mutex mutex;
+};
+
+struct Query
+{
+    enum Kind {Distance, Reachability};
+    static const std::uint32_t UNREACHED = ~std::uint32_t(0);
+
+    Kind kind;
+    std::size_t source; // original ids
+    std::size_t target;
+    VertexId denseTarget;
+    std::uint32_t slot;     // bit of the source in the batch
+    std::uint32_t nextSame; // next query of the batch with the same target, or NO_QUERY
+    std::uint32_t distance;
+    std::chrono::steady_clock::time_point arrival;
+    std::shared_ptr<QueryConnection> connection;
+};
+
+// Records the levels at which the targets of a batch are found. The queries of a target form a chain,
+// found() only looks at the head of the chain of v, which is empty for almost every vertex.
+template <unsigned int bitsetSize>
+class QuerySink
+{
+public:
+    static const std::uint32_t NO_QUERY = ~std::uint32_t(0);
+
+    QuerySink(const CsrGraph& g): targetHeads(g.nodeNum(), NO_QUERY), queries(nullptr) {}
+
+    // links the queries of the coming batch, their slots have to be set already
+    void prepare(std::vector<Query>& batch)
+    {
+        queries = &batch;
+        for(std::uint32_t q = 0; q < batch.size(); ++q)
+        {
+            batch[q].nextSame = targetHeads[batch[q].denseTarget];
+            targetHeads[batch[q].denseTarget] = q;
+        }
+    }
+
+    // unlinks them again, so a batch costs O(queries) and not O(vertices)
+    void release()
+    {
+        for(const Query& query: *queries)
+        {
+            targetHeads[query.denseTarget] = NO_QUERY;
+        }
+        queries = nullptr;
+    }
+
+    void beginBatch(std::size_t, const VertexId*, std::size_t) {}
+
+    // a source reaches a vertex once, so every query is written by one worker only
+    void found(std::size_t level, VertexId v, const ParallelLabel* label)
+    {
+        for(std::uint32_t q = targetHeads[v]; q != NO_QUERY; q = (*queries)[q].nextSame)
+        {
+            Query& query = (*queries)[q];
+            if(label[query.slot / LABEL_WORD_BITS] & (ParallelLabel(1) << (query.slot % LABEL_WORD_BITS)))
+            {
+                query.distance = level;
+            }
+        }
+    }
+
+    void endLevel() {}
+    void endBatch() {}
+private:
+    std::vector<std::uint32_t> targetHeads; // dense vertex -> first query of the batch targeting it
+    std::vector<Query>* queries;
+};
+
+template <unsigned int bitsetSize>
+const std::uint32_t QuerySink<bitsetSize>::NO_QUERY;
+
+struct QueryServerStats
+{
+    std::uint64_t queries;
+    std::uint64_t batches;
+    double sourcesPerBatch;
+    double p50Milliseconds;
+    double p99Milliseconds;
+    double queriesPerSecond;
+};
+
+template <unsigned int bitsetSize>
+class QueryServer
+{
+public:
+    // latencies of the most recent queries the percentiles are computed from
+    static const std::size_t LATENCY_WINDOW = 1 << 16;
+
+    // maxMemory is the budget of the engine in bytes, 0 for none (see MsBfs::memoryBytes)
+    QueryServer(const CsrGraph& g_, std::chrono::microseconds window_, std::size_t maxMemory = 0):
+        g(g_), window(window_), engine(g_, NumaPlacement::Naive, maxMemory), sink(g_),
+        stopping(false), queryNum(0), batchNum(0), batchSourceNum(0), latencies(LATENCY_WINDOW), latencyNum(0) {}
+
+    // parses a request line and queues the query; thread-safe
+    void handleLine(const std::string& line, const std::shared_ptr<QueryConnection>& connection);
+    // runs batches until shutdown() was called and the queue is empty
+    void run();
+    void shutdown();
+    QueryServerStats getStats();
+
+    // reads requests from a file descriptor until it is closed or the server stops, e.g. stdin or a
+    // socket connection
+    void readRequests(int fd, const std::shared_ptr<QueryConnection>& connection);
+    // accepts clients on a Unix socket, one reader thread per client; returns once the server stops
+    void listenUnixSocket(const std::string& path);
+private:
+    bool parseVertex(const std::string& field, std::size_t& id, VertexId& v);
+    bool isStopping();
+    void collectBatch(std::vector<Query>& batch, std::vector<VertexId>& sources);
+    void runBatch(std::vector<Query>& batch, const std::vector<VertexId>& sources);
+    const CsrGraph& g;
+    std::chrono::microseconds window;
+    MsBfs<bitsetSize, QuerySink<bitsetSize>> engine;
+    QuerySink<bitsetSize> sink;
+    std::mutex mutex; // guards the queue, the flags and the statistics
+    std::condition_variable queued;
+    std::deque<Query> queue;
+    bool stopping;
+    std::chrono::steady_clock::time_point firstArrival;
+    std::uint64_t queryNum;
+    std::uint64_t batchNum;
+    std::uint64_t batchSourceNum;
+    std::vector<double> latencies; // ring buffer, in milliseconds
+    std::uint64_t latencyNum;
+};
+
+template <unsigned int bitsetSize>
+const std::size_t QueryServer<bitsetSize>::LATENCY_WINDOW;
+
+template <unsigned int bitsetSize>
+bool QueryServer<bitsetSize>::parseVertex(const std::string& field, std::size_t& id, VertexId& v)
+{
+    if(field.empty() || field.size() > 18 || field.find_first_not_of("0123456789") != std::string::npos)
+    {
+        return false;
+    }
+    id = std::stoull(field);
+    v = id <= g.maxNodeId() ? g.denseId(id) : INVALID_VERTEX;
+    return v != INVALID_VERTEX;
+}
+
+template <unsigned int bitsetSize>
+void QueryServer<bitsetSize>::handleLine(const std::string& line, const std::shared_ptr<QueryConnection>& connection)
+{
+    std::istringstream fields(line);
+    std::string command, source, target;
+    fields >> command >> source >> target;
+    if(command.empty())
+    {
+        return;
+    }
+    if(command == "stats")
+    {
+        QueryServerStats stats = getStats();
+        std::ostringstream out;
+        out << "stats queries " << stats.queries << " batches " << stats.batches << " sources/batch " << stats.sourcesPerBatch
+            << " p50 " << stats.p50Milliseconds << " p99 " << stats.p99Milliseconds << " qps " << stats.queriesPerSecond;
+        connection->reply(out.str());
+        return;
+    }
+    if(command == "shutdown")
+    {
+        shutdown();
+        return;
+    }
+
+    Query query;
+    VertexId denseSource;
+    if(command == "dist")
+    {
+        query.kind = Query::Distance;
+    }
+    else if(command == "reach")
+    {
+        query.kind = Query::Reachability;
+    }
+    else
+    {
+        connection->reply("error unknown request: " + line);
+        return;
+    }
+    if(!parseVertex(source, query.source, denseSource) || !parseVertex(target, query.target, query.denseTarget))
+    {
+        connection->reply("error not a vertex: " + line);
+        return;
+    }
+    // the batch remembers the dense source in the slot until the sources are numbered
+    query.slot = denseSource;
+    query.distance = Query::UNREACHED;
+    query.arrival = std::chrono::steady_clock::now();
+    query.connection = connection;
+
+    {
+        // run() may already have returned, a query queued now would never be answered
+        std::lock_guard<std::mutex> lock(mutex);
+        if(!stopping)
+        {
+            if(queryNum == 0 && queue.empty())
+            {
+                firstArrival = query.arrival;
+            }
+            queue.push_back(std::move(query));
+            queued.notify_one();
+            return;
+        }
+    }
+    connection->reply("error server is shutting down: " + line);
+}
+
+template <unsigned int bitsetSize>
+void QueryServer<bitsetSize>::shutdown()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    queued.notify_one();
+}
+
+template <unsigned int bitsetSize>
+bool QueryServer<bitsetSize>::isStopping()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stopping;
+}
+
+// Waits for the first query, then until the batch has bitsetSize distinct sources or the first query has
+// waited for the window. The batch ends before the first query whose source does not fit any more.
+template <unsigned int bitsetSize>
+void QueryServer<bitsetSize>::collectBatch(std::vector<Query>& batch, std::vector<VertexId>& sources)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    queued.wait(lock, [this] {return stopping || !queue.empty();});
+    if(queue.empty())
+    {
+        return;
+    }
+
+    auto deadline = queue.front().arrival + window;
+    auto distinctSources = [this] (std::size_t limit) {
+        std::vector<VertexId> seen;
+        for(const Query& query: queue)
+        {
+            if(std::find(seen.begin(), seen.end(), query.slot) == seen.end())
+            {
+                seen.push_back(query.slot);
+                if(seen.size() >= limit)
+                {
+                    break;
+                }
+            }
+        }
+        return seen.size();
+    };
+    queued.wait_until(lock, deadline, [&] {return stopping || distinctSources(bitsetSize) >= bitsetSize;});
+
+    // the batch takes a prefix of the queue, so that the answers go out in the order the queries came in
+    while(!queue.empty())
+    {
+        auto slot = std::find(sources.begin(), sources.end(), queue.front().slot);
+        if(slot == sources.end())
+        {
+            if(sources.size() == bitsetSize)
+            {
+                break;
+            }
+            sources.push_back(queue.front().slot);
+            slot = sources.end() - 1;
+        }
+        batch.push_back(std::move(queue.front()));
+        batch.back().slot = slot - sources.begin();
+        queue.pop_front();
+    }
+}
+
+template <unsigned int bitsetSize>
+void QueryServer<bitsetSize>::runBatch(std::vector<Query>& batch, const std::vector<VertexId>& sources)
+{
+    sink.prepare(batch);
+    engine.hybridMsPbfs(sources, sink);
+    sink.release();
+
+    auto now = std::chrono::steady_clock::now();
+    std::vector<double> batchLatencies;
+    for(Query& query: batch)
+    {
+        if(sources[query.slot] == query.denseTarget)
+        {
+            query.distance = 0;
+        }
+        std::ostringstream out;
+        if(query.kind == Query::Distance)
+        {
+            out << "dist " << query.source << ' ' << query.target << ' '
+                << (query.distance == Query::UNREACHED ? -1 : std::int64_t(query.distance));
+        }
+        else
+        {
+            out << "reach " << query.source << ' ' << query.target << ' ' << (query.distance != Query::UNREACHED);
+        }
+        query.connection->reply(out.str());
+        batchLatencies.push_back(std::chrono::duration<double, std::milli>(now - query.arrival).count());
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    queryNum += batch.size();
+    ++batchNum;
+    batchSourceNum += sources.size();
+    for(double latency: batchLatencies)
+    {
+        latencies[latencyNum++ % LATENCY_WINDOW] = latency;
+    }
+}
+
+template <unsigned int bitsetSize>
+void QueryServer<bitsetSize>::run()
+{
+    std::vector<Query> batch;
+    std::vector<VertexId> sources;
+    while(true)
+    {
+        batch.clear();
+        sources.clear();
+        collectBatch(batch, sources);
+        if(batch.empty())
+        {
+            return; // stopping and nothing left
+        }
+        runBatch(batch, sources);
+    }
+}
+
+template <unsigned int bitsetSize>
+QueryServerStats QueryServer<bitsetSize>::getStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    QueryServerStats stats = {queryNum, batchNum, 0, 0, 0, 0};
+    if(batchNum == 0)
+    {
+        return stats;
+    }
+    stats.sourcesPerBatch = double(batchSourceNum) / batchNum;
+    std::vector<double> recent(latencies.begin(), latencies.begin() + std::min<std::uint64_t>(latencyNum, LATENCY_WINDOW));
+    std::sort(recent.begin(), recent.end());
+    stats.p50Milliseconds = recent[(recent.size() - 1) / 2];
+    stats.p99Milliseconds = recent[(recent.size() - 1) * 99 / 100];
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - firstArrival;
+    stats.queriesPerSecond = elapsed.count() > 0 ? queryNum / elapsed.count() : 0;
+    return stats;
+}
+
+template <unsigned int bitsetSize>
+void QueryServer<bitsetSize>::readRequests(int fd, const std::shared_ptr<QueryConnection>& connection)
+{
+    std::string pending;
+    char buffer[4096];
+    ssize_t n = 0;
+    // a shutdown read here ends the reader, stdin would otherwise keep it waiting for the end of input
+    while(!isStopping() && (n = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        pending.append(buffer, n);
+        std::size_t begin = 0;
+        for(std::size_t end; (end = pending.find('\n', begin)) != std::string::npos; begin = end + 1)
+        {
+            handleLine(pending.substr(begin, end - begin), connection);
+        }
+        pending.erase(0, begin);
+    }
+    if(n == 0 && !pending.empty())
+    {
+        handleLine(pending, connection);
+    }
+}
+
+template <unsigned int bitsetSize>
+void QueryServer<bitsetSize>::listenUnixSocket(const std::string& path)
+{
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if(listener < 0 || path.size() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error("cannot create socket " + path);
+    }
+    std::strcpy(address.sun_path, path.c_str());
+    unlink(path.c_str());
+    if(bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0)
+    {
+        close(listener);
+        throw std::runtime_error("cannot listen on " + path);
+    }
+
+    // The readers are detached, so a finished client leaves neither a thread nor a descriptor behind. A
+    // reader owns its connection, which closes the descriptor once the reader and the client's queued
+    // queries are done with it, and unregisters the descriptor before it lets go of it. Once the server
+    // stops, shutting the registered (still open) sockets down wakes the blocked accept() and read()
+    // calls, and the server waits for the readers to unregister.
+    std::mutex clientMutex;
+    std::condition_variable clientsDone;
+    std::set<int> clients;
+    std::thread acceptor([&] {
+        int fd;
+        while((fd = accept(listener, nullptr, nullptr)) >= 0)
+        {
+            std::shared_ptr<QueryConnection> connection = std::make_shared<QueryConnection>(fd, true);
+            std::lock_guard<std::mutex> lock(clientMutex);
+            clients.insert(fd);
+            std::thread([this, fd, connection, &clientMutex, &clientsDone, &clients] () mutable {
+                readRequests(fd, connection);
+                {
+                    std::lock_guard<std::mutex> lock(clientMutex);
+                    clients.erase(fd);
+                    clientsDone.notify_all();
+                }
+                connection.reset();
+            }).detach();
+        }
+    });
+    run();
+    ::shutdown(listener, SHUT_RDWR);
+    acceptor.join();
+    {
+        std::unique_lock<std::mutex> lock(clientMutex);
+        for(int fd: clients)
+        {
+            ::shutdown(fd, SHUT_RD);
+        }
+        clientsDone.wait(lock, [&] {return clients.empty();});
+    }
+    close(listener);
+    unlink(path.c_str());
+}
+
+#endif
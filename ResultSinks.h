@@ -0,0 +1,286 @@
+#ifndef RESULTSINKS_H
+#define RESULTSINKS_H
+
+#include <ostream>
+#include <string>
+
+#include "tbb/enumerable_thread_specific.h"
+
+#include "Types.h"
+#include "CsrGraph.h"
+
+// Result sinks receive the discoveries of an MsBfs run. The engine takes the sink type as a template
+// parameter, so found() is inlined into the level kernels. A sink provides
+//
+//   void beginBatch(std::size_t firstSource, const VertexId* sources, std::size_t count);
+//   void found(std::size_t level, VertexId v, const ParallelLabel* label);  // from any worker
+//   void endLevel();                                                          // between passes
+//   void endBatch();
+//
+// where v is a dense vertex id and bit i of label stands for source firstSource + i. found() is called
+// concurrently, the sinks below collect into thread-local buffers and hand those over in endLevel() or
+// endBatch(), which run on the calling thread.
+
+
+// drops everything, for timing the traversal alone
+template <unsigned int bitsetSize>
+class DiscardSink
+{
+public:
+    void beginBatch(std::size_t, const VertexId*, std::size_t) {}
+    void found(std::size_t, VertexId, const ParallelLabel*) {}
+    void endLevel() {}
+    void endBatch() {}
+};
+
+// Calls a PrintFunctionType callback for every discovery. The records are buffered per worker and the
+// callback runs serially at the end of each level, so it does not have to be thread-safe.
+template <unsigned int bitsetSize>
+class CallbackSink
+{
+public:
+    CallbackSink(const CsrGraph& g_, std::function<PrintFunctionType<bitsetSize>> callback_): g(g_), callback(callback_), firstSource(0) {}
+
+    void beginBatch(std::size_t first, const VertexId*, std::size_t)
+    {
+        firstSource = first;
+    }
+
+    void found(std::size_t level, VertexId v, const ParallelLabel* label)
+    {
+        records.local().push_back(Record{level, v, toBitset<bitsetSize>(label)});
+    }
+
+    void endLevel()
+    {
+        for(auto& localRecords: records)
+        {
+            for(const Record& r: localRecords)
+            {
+                callback(r.level, g.originalId(r.v), g.maxNodeId(), firstSource, r.label);
+            }
+            localRecords.clear();
+        }
+    }
+
+    void endBatch()
+    {
+        endLevel();
+    }
+private:
+    struct Record
+    {
+        std::size_t level;
+        VertexId v;
+        std::bitset<bitsetSize> label;
+    };
+    const CsrGraph& g;
+    std::function<PrintFunctionType<bitsetSize>> callback;
+    std::size_t firstSource;
+    tbb::enumerable_thread_specific<std::vector<Record>> records;
+};
+
+// Writes the lines of printNodeFound. Every worker formats into its own buffer, the buffers go to the
+// stream in one write per worker and level, without flushing.
+template <unsigned int bitsetSize>
+class PrintSink
+{
+public:
+    PrintSink(const CsrGraph& g_, std::ostream& out_): g(g_), out(out_), firstSource(0) {}
+
+    void beginBatch(std::size_t first, const VertexId*, std::size_t)
+    {
+        firstSource = first;
+    }
+
+    void found(std::size_t level, VertexId v, const ParallelLabel* label)
+    {
+        std::string& buffer = buffers.local();
+        buffer += std::to_string(g.originalId(v));
+        buffer += " is found on level\t";
+        buffer += std::to_string(level);
+        buffer += "\tin the following BFS(s):\t";
+        labelForEachBit<LabelWords<bitsetSize>::count>(label, [&] (std::size_t i) {
+            buffer += std::to_string(firstSource + i + 1);
+            buffer += ' ';
+        });
+        buffer += '\n';
+    }
+
+    void endLevel()
+    {
+        for(auto& buffer: buffers)
+        {
+            out.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+
+    void endBatch()
+    {
+        endLevel();
+    }
+private:
+    const CsrGraph& g;
+    std::ostream& out;
+    std::size_t firstSource;
+    tbb::enumerable_thread_specific<std::string> buffers;
+};
+
+// Distances of every vertex from every source, UNREACHED where there is no path. Each (source, vertex)
+// pair is found exactly once, so the workers write their entries directly without any buffering.
+template <unsigned int bitsetSize>
+class DistanceMatrixSink
+{
+public:
+    using Distance = std::uint16_t;
+    static const Distance UNREACHED = std::numeric_limits<Distance>::max();
+
+    DistanceMatrixSink(const CsrGraph& g_, std::size_t sourceNum): g(g_), firstSource(0),
+        distances(sourceNum * g_.nodeNum(), UNREACHED) {}
+
+    void beginBatch(std::size_t first, const VertexId* sources, std::size_t count)
+    {
+        firstSource = first;
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            distances[(first + i) * g.nodeNum() + sources[i]] = 0;
+        }
+    }
+
+    void found(std::size_t level, VertexId v, const ParallelLabel* label)
+    {
+        labelForEachBit<LabelWords<bitsetSize>::count>(label, [&] (std::size_t i) {
+            distances[(firstSource + i) * g.nodeNum() + v] = level;
+        });
+    }
+
+    void endLevel() {}
+    void endBatch() {}
+
+    Distance distance(std::size_t source, VertexId v) const
+    {
+        return distances[source * g.nodeNum() + v];
+    }
+
+    // row of a source, indexed by dense vertex id
+    const Distance* row(std::size_t source) const
+    {
+        return distances.data() + source * g.nodeNum();
+    }
+private:
+    const CsrGraph& g;
+    std::size_t firstSource;
+    std::vector<Distance> distances;
+};
+
+template <unsigned int bitsetSize>
+const typename DistanceMatrixSink<bitsetSize>::Distance DistanceMatrixSink<bitsetSize>::UNREACHED;
+
+// Number of vertices found on each level, per source. Workers count into thread-local level x bit
+// tables that are added up at the end of each batch.
+template <unsigned int bitsetSize>
+class LevelCountSink
+{
+public:
+    LevelCountSink(std::size_t sourceNum): counts(sourceNum), firstSource(0) {}
+
+    void beginBatch(std::size_t first, const VertexId*, std::size_t count)
+    {
+        firstSource = first;
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            counts[first + i].assign(1, 1); // the source itself on level 0
+        }
+    }
+
+    void found(std::size_t level, VertexId, const ParallelLabel* label)
+    {
+        std::vector<std::uint64_t>& local = localCounts.local();
+        if(local.size() < (level + 1) * bitsetSize)
+        {
+            local.resize((level + 1) * bitsetSize, 0);
+        }
+        labelForEachBit<LabelWords<bitsetSize>::count>(label, [&] (std::size_t i) {
+            ++local[level * bitsetSize + i];
+        });
+    }
+
+    void endLevel() {}
+
+    void endBatch()
+    {
+        for(auto& local: localCounts)
+        {
+            for(std::size_t j = 0; j < local.size(); ++j)
+            {
+                if(local[j] == 0)
+                {
+                    continue;
+                }
+                std::vector<std::uint64_t>& sourceCounts = counts[firstSource + j % bitsetSize];
+                std::size_t level = j / bitsetSize;
+                if(sourceCounts.size() <= level)
+                {
+                    sourceCounts.resize(level + 1, 0);
+                }
+                sourceCounts[level] += local[j];
+            }
+            local.clear();
+        }
+    }
+
+    // counts of a source, indexed by level
+    const std::vector<std::uint64_t>& levelCounts(std::size_t source) const
+    {
+        return counts[source];
+    }
+private:
+    std::vector<std::vector<std::uint64_t>> counts;
+    std::size_t firstSource;
+    tbb::enumerable_thread_specific<std::vector<std::uint64_t>> localCounts;
+};
+
+// Adjacency entries of the vertices every source reaches, the sources included. Halved this is the
+// number of undirected edges a search traversed, the numerator of Graph500 TEPS.
+template <unsigned int bitsetSize>
+class TraversedEdgeSink
+{
+public:
+    TraversedEdgeSink(const CsrGraph& g_): g(g_), total(0), localTotals(0) {}
+
+    void beginBatch(std::size_t, const VertexId* sources, std::size_t count)
+    {
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            total += g.degree(sources[i]);
+        }
+    }
+
+    void found(std::size_t, VertexId v, const ParallelLabel* label)
+    {
+        localTotals.local() += g.degree(v) * labelCount<LabelWords<bitsetSize>::count>(label);
+    }
+
+    void endLevel() {}
+
+    void endBatch()
+    {
+        for(std::uint64_t& local: localTotals)
+        {
+            total += local;
+            local = 0;
+        }
+    }
+
+    std::uint64_t adjacencyEntries() const
+    {
+        return total;
+    }
+private:
+    const CsrGraph& g;
+    std::uint64_t total;
+    tbb::enumerable_thread_specific<std::uint64_t> localTotals;
+};
+
+#endif
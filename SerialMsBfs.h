@@ -0,0 +1,160 @@
+#ifndef SERIALMSBFS_H
+#define SERIALMSBFS_H
+
+#include <algorithm>
+
+#include "Types.h"
+#include "CsrGraph.h"
+
+// The serial MS-BFS of the paper, top-down (Listing 1) and bottom-up (Listing 2).
+// They are the reference the parallel engine of MsPbfs.h is checked and benchmarked against.
+// The labels are words of the same layout as the engine's (see LabelKernels.h), at most bitsetSize
+// sources are run at once. The callback is a template parameter, so it is inlined like a sink; it
+// gets the PrintFunctionType arguments, a std::function<PrintFunctionType<bitsetSize>> works as well.
+
+template <unsigned int bitsetSize, typename Callback>
+void TopDownMsBfs(const CsrGraph& g, const std::vector<VertexId>& sources, Callback callback)
+{
+    constexpr std::size_t words = LabelWords<bitsetSize>::count;
+    // during the loop we always use the previous 'next' as the new 'frontier'. To avoid data copying we are simply swapping the two maps after each iteration.
+    std::vector<ParallelLabel> map1(g.nodeNum() * words, 0);
+    std::vector<ParallelLabel> map2(g.nodeNum() * words, 0);
+    std::vector<ParallelLabel> seen(g.nodeNum() * words, 0);
+    ParallelLabel* frontier = map1.data();
+    ParallelLabel* next = map2.data();
+
+    // initializing start nodes
+    for(std::size_t i = 0; i < sources.size(); ++i)
+    {
+        VertexId s = sources[i];
+        labelSet(&frontier[s * words], i); // set frontier for sources
+        labelSet(&seen[s * words], i); // set seen for sources
+    }
+
+    bool foundNewNode = true;
+    std::size_t iterationNum = 1;
+
+    while(foundNewNode)
+    {
+        // these parts were omitted from the paper:
+        //  condition for the loop: we check whether we found any new nodes last time (if not then we can have at most one additional round but still way cheaper than checking each bit in each round) - this is a small deviation from the original algorithm
+        //  we have to use the previous 'next' as the new 'frontier'
+        //  have to set all 'next' values to 0
+        foundNewNode = false;
+
+        std::fill(next, next + g.nodeNum() * words, 0);
+
+        // body of the algorithm (Listing 1)
+        for (VertexId v = 0; v < g.nodeNum(); ++v)
+        {
+            const ParallelLabel* label = &frontier[v * words];
+            if(labelIsZero<words>(label))
+            {
+                continue;
+            }
+
+            for (const VertexId* e = g.neighboursBegin(v); e != g.neighboursEnd(v); ++e) //iterating edges starting from v
+            {
+                VertexId neighbour = *e; // 'other' end of edge (ie neighbours)
+                labelOr<words>(&next[neighbour * words], label);
+            }
+        }
+
+        for (VertexId v = 0; v < g.nodeNum(); ++v)
+        {
+            ParallelLabel* label = &next[v * words];
+            if(labelIsZero<words>(label))
+            {
+                continue;
+            }
+
+            labelAndNot<words>(label, &seen[v * words]);
+            if(!labelIsZero<words>(label))
+            {
+                labelOr<words>(&seen[v * words], label);
+                callback(iterationNum, g.originalId(v), g.maxNodeId(), 0, toBitset<bitsetSize>(label));
+                foundNewNode = true;
+            }
+        }
+
+        std::swap(frontier, next);
+        ++iterationNum;
+    }
+
+}
+
+// returns how many edge checks the early exit saved
+template <unsigned int bitsetSize, typename Callback>
+BottomUpStats BottomUpMsBfs(const CsrGraph& g, const std::vector<VertexId>& sources, Callback callback)
+{
+    constexpr std::size_t words = LabelWords<bitsetSize>::count;
+    // during the loop we always use the previous 'next' as the new 'frontier'. To avoid data copying we are simply swapping the two maps after each iteration.
+    std::vector<ParallelLabel> map1(g.nodeNum() * words, 0);
+    std::vector<ParallelLabel> map2(g.nodeNum() * words, 0);
+    std::vector<ParallelLabel> seen(g.nodeNum() * words, 0);
+    ParallelLabel* frontier = map1.data();
+    ParallelLabel* next = map2.data();
+
+    ParallelLabel allSources[words] = {}; // bits of the sources, a vertex is done once its 'seen' has all of them
+
+    // initializing start nodes
+    for(std::size_t i = 0; i < sources.size(); ++i)
+    {
+        VertexId s = sources[i];
+        labelSet(&frontier[s * words], i); // set frontier for sources
+        labelSet(&seen[s * words], i); // set seen for sources
+        labelSet(allSources, i);
+    }
+    BottomUpStats stats = {0, 0};
+
+    bool foundNewNode = true;
+    std::size_t iterationNum = 1;
+
+    while(foundNewNode)
+    {
+        foundNewNode = false;
+
+        // body of the algorithm (Listing 2), every 'next' label is overwritten
+        for (VertexId v = 0; v < g.nodeNum(); ++v)
+        {
+            ParallelLabel* label = &next[v * words];
+            labelClear<words>(label);
+            ParallelLabel missing[words];
+            std::copy(allSources, allSources + words, missing);
+            labelAndNot<words>(missing, &seen[v * words]);
+            if(labelIsZero<words>(missing))
+            {
+                continue;
+            }
+
+            const VertexId* end = g.neighboursEnd(v);
+            for (const VertexId* e = g.neighboursBegin(v); e != end; ++e) //iterating edges starting from v
+            {
+                VertexId neighbour = *e; // 'other' end of edge (ie neighbours)
+                labelOr<words>(label, &frontier[neighbour * words]);
+                if(labelCovers<words>(label, missing)) // every missing source found, the other neighbours cannot add anything
+                {
+                    stats.skippedEdges += end - e - 1;
+                    end = e + 1;
+                    break;
+                }
+            }
+            stats.checkedEdges += end - g.neighboursBegin(v);
+
+            labelAndNot<words>(label, &seen[v * words]);
+            labelOr<words>(&seen[v * words], label);
+
+            if(!labelIsZero<words>(label))
+            {
+                callback(iterationNum, g.originalId(v), g.maxNodeId(), 0, toBitset<bitsetSize>(label));
+                foundNewNode = true;
+            }
+        }
+
+        std::swap(frontier, next);
+        ++iterationNum;
+    }
+    return stats;
+}
+
+#endif
@@ -12,6 +12,13 @@
 #include <cstdlib>
 #include <memory>
 #include <chrono>
+#include <cstdint>
+#include <limits>
+
+#include "tbb/blocked_range.h"
+#include "tbb/cache_aligned_allocator.h"
+
+#include "LabelKernels.h"
 
 #include <lemon/list_graph.h>
 #include <lemon/lgf_writer.h>
@@ -21,12 +28,74 @@ using namespace lemon;
 
 using Node = ListGraph::Node;
 using Edge = ListGraph::Edge;
+
+using VertexId = std::uint32_t;
+using EdgeIndex = std::uint64_t;
+const VertexId INVALID_VERTEX = std::numeric_limits<VertexId>::max();
  
  
 template < unsigned int bitsetSize > using Label = std::bitset<bitsetSize>;
-using ParallelLabel = std::shared_ptr<std::atomic<int>>;
+// flat label storage indexed by dense vertex id, aligned to cache lines
+using LabelArray = std::vector<ParallelLabel, tbb::cache_aligned_allocator<ParallelLabel>>;
 
-template < unsigned int bitsetSize > using PrintFunctionType = void(std::size_t, std::size_t, std::size_t, std::bitset<bitsetSize>);
+// Labels are plain words so that the owner of a vertex can update them without atomics.
+// Only the top-down scatter writes labels of other vertices, it goes through these.
+inline ParallelLabel atomicLoad(const ParallelLabel& label)
+{
+	return __atomic_load_n(&label, __ATOMIC_RELAXED);
+}
+
+inline ParallelLabel atomicFetchOr(ParallelLabel& label, ParallelLabel bits)
+{
+	return __atomic_fetch_or(&label, bits, __ATOMIC_RELAXED);
+}
+
+inline void atomicStore(ParallelLabel& label, ParallelLabel value)
+{
+	__atomic_store_n(&label, value, __ATOMIC_RELAXED);
+}
+
+// counters shared by the workers of the graph ingestion
+inline std::uint64_t atomicFetchAdd(std::uint64_t& counter, std::uint64_t value)
+{
+	return __atomic_fetch_add(&counter, value, __ATOMIC_RELAXED);
+}
+
+// how the label words were written by the top-down scatter
+struct ScatterStats
+{
+	std::uint64_t atomicUpdates;   // fetch_or actually issued
+	std::uint64_t skippedUpdates;  // bits were already set, no read-modify-write needed
+	std::uint64_t bufferedUpdates; // went to a thread-local hub buffer instead
+	std::uint64_t scannedEdges;    // adjacency entries scattered
+};
+
+// how much of the adjacencies the bottom-up kernel read, it stops a vertex once every missing source was found
+struct BottomUpStats
+{
+	EdgeIndex checkedEdges;
+	EdgeIndex skippedEdges;
+
+	double skippedRatio() const
+	{
+		EdgeIndex total = checkedEdges + skippedEdges;
+		return total > 0 ? double(skippedEdges) / total : 0;
+	}
+};
+
+// what a level discovered, drives the direction and the sparse/dense decisions
+struct LevelStats
+{
+	std::size_t frontierNodes;  // vertices in the new frontier
+	EdgeIndex frontierEdges;    // sum of their degrees
+	EdgeIndex exploredEdges;    // degrees of the vertices that became seen by every source
+	EdgeIndex checkedEdges;     // bottom-up: adjacency entries read
+	EdgeIndex skippedEdges;     // bottom-up: entries left unread once every missing source was found
+	EdgeIndex traversedEdges;   // degrees times the sources that found the vertex, only counted when profiling
+};
+
+// level, node id, max node id, index of the first source of the batch, sources of the batch that found the node
+template < unsigned int bitsetSize > using PrintFunctionType = void(std::size_t, std::size_t, std::size_t, std::size_t, std::bitset<bitsetSize>);
 
 template<typename T>
 struct NeighbourTopDownExecutor
@@ -83,6 +152,70 @@ struct MsPBfsBottomUpExecutor
 
 
 
+template<typename T>
+struct HubMergeExecutor
+{
+	HubMergeExecutor(T& e):_msbfs(e)
+	{}
+	
+	HubMergeExecutor(HubMergeExecutor& e,tbb::split):_msbfs(e._msbfs)
+	{}
+
+	void operator()(const tbb::blocked_range<size_t>& r) const {
+		_msbfs.mergeHubBuffers(r.begin(), r.end());
+	}
+
+	T& _msbfs;
+};
+
+template<typename T>
+struct SparseScatterExecutor
+{
+	SparseScatterExecutor(T& e):_msbfs(e)
+	{}
+	
+	SparseScatterExecutor(SparseScatterExecutor& e,tbb::split):_msbfs(e._msbfs)
+	{}
+
+	void operator()(const tbb::blocked_range<size_t>& r) const {
+		_msbfs.scatterSparse(r.begin(), r.end());
+	}
+
+	T& _msbfs;
+};
+
+template<typename T>
+struct SparseProcessorExecutor
+{
+	SparseProcessorExecutor(T& e):_msbfs(e)
+	{}
+	
+	SparseProcessorExecutor(SparseProcessorExecutor& e,tbb::split):_msbfs(e._msbfs)
+	{}
+
+	void operator()(const tbb::blocked_range<size_t>& r) const {
+		_msbfs.processSparse(r.begin(), r.end());
+	}
+
+	T& _msbfs;
+};
+
+template<typename T>
+struct SparseCleanerExecutor
+{
+	SparseCleanerExecutor(T& e):_msbfs(e)
+	{}
+	
+	SparseCleanerExecutor(SparseCleanerExecutor& e,tbb::split):_msbfs(e._msbfs)
+	{}
+
+	void operator()(const tbb::blocked_range<size_t>& r) const {
+		_msbfs.cleanSparse(r.begin(), r.end());
+	}
+
+	T& _msbfs;
+};
+
 template<typename T>
 struct CleanerExecutor
 {
@@ -0,0 +1,189 @@
+#ifndef VERTEXORDER_H
+#define VERTEXORDER_H
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+#include "tbb/parallel_sort.h"
+
+#include "Types.h"
+#include "CsrGraph.h"
+
+// Relabeling of the dense vertex ids so that vertices which are visited together are stored together.
+// The labels of MsBfs are indexed by dense id, so the order decides how scattered the label accesses
+// of a traversal are. A reordered snapshot keeps the original ids of its vertices, so results are
+// still reported in terms of the input graph; only the dense sources have to be translated.
+//
+//   degree   by decreasing degree, the hubs and their labels share a few cache lines
+//   rcm      reverse Cuthill-McKee, neighbours get close ids (small bandwidth)
+//   bfs      the order in which a BFS from the largest hub of every component visits the vertices
+//   hub      vertices of more than average degree first, both groups keep their original order
+
+enum class VertexOrdering : std::uint32_t
+{
+    Original = 0,
+    Degree,
+    Rcm,
+    Bfs,
+    HubCluster
+};
+
+inline const char* vertexOrderingName(VertexOrdering ordering)
+{
+    switch(ordering)
+    {
+        case VertexOrdering::Original: return "original";
+        case VertexOrdering::Degree: return "degree";
+        case VertexOrdering::Rcm: return "rcm";
+        case VertexOrdering::Bfs: return "bfs";
+        case VertexOrdering::HubCluster: return "hub";
+    }
+    return "unknown";
+}
+
+inline VertexOrdering parseVertexOrdering(const std::string& name)
+{
+    for(VertexOrdering ordering: {VertexOrdering::Original, VertexOrdering::Degree, VertexOrdering::Rcm, VertexOrdering::Bfs, VertexOrdering::HubCluster})
+    {
+        if(name == vertexOrderingName(ordering))
+        {
+            return ordering;
+        }
+    }
+    throw std::runtime_error("unknown vertex ordering " + name + " (original, degree, rcm, bfs or hub)");
+}
+
+// visits every vertex once, component by component, starting a BFS at the first unvisited vertex of
+// 'starts'; neighbours are queued in the order given by 'less'
+template <typename Less>
+std::vector<VertexId> bfsVertexOrder(const CsrGraph& g, const std::vector<VertexId>& starts, Less less)
+{
+    std::vector<VertexId> order;
+    order.reserve(g.nodeNum());
+    std::vector<bool> visited(g.nodeNum(), false);
+    std::vector<VertexId> neighbours;
+    for(VertexId start: starts)
+    {
+        if(visited[start])
+        {
+            continue;
+        }
+        visited[start] = true;
+        order.push_back(start);
+        // 'order' doubles as the queue of the current component
+        for(std::size_t head = order.size() - 1; head < order.size(); ++head)
+        {
+            VertexId v = order[head];
+            neighbours.clear();
+            for(const VertexId* e = g.neighboursBegin(v); e != g.neighboursEnd(v); ++e)
+            {
+                if(!visited[*e])
+                {
+                    visited[*e] = true;
+                    neighbours.push_back(*e);
+                }
+            }
+            std::stable_sort(neighbours.begin(), neighbours.end(), less);
+            order.insert(order.end(), neighbours.begin(), neighbours.end());
+        }
+    }
+    return order;
+}
+
+// order[i] is the current dense id of the vertex that gets dense id i
+inline std::vector<VertexId> computeVertexOrder(const CsrGraph& g, VertexOrdering ordering)
+{
+    std::vector<VertexId> order(g.nodeNum());
+    std::iota(order.begin(), order.end(), 0);
+    auto byDegreeDescending = [&g] (VertexId a, VertexId b) {
+        return g.degree(a) > g.degree(b) || (g.degree(a) == g.degree(b) && a < b);
+    };
+    auto byDegreeAscending = [&g] (VertexId a, VertexId b) {
+        return g.degree(a) < g.degree(b) || (g.degree(a) == g.degree(b) && a < b);
+    };
+
+    switch(ordering)
+    {
+        case VertexOrdering::Original:
+            break;
+        case VertexOrdering::Degree:
+            tbb::parallel_sort(order.begin(), order.end(), byDegreeDescending);
+            break;
+        case VertexOrdering::Rcm:
+        {
+            // Cuthill-McKee from a vertex of minimum degree of every component, then reversed
+            tbb::parallel_sort(order.begin(), order.end(), byDegreeAscending);
+            order = bfsVertexOrder(g, order, byDegreeAscending);
+            std::reverse(order.begin(), order.end());
+            break;
+        }
+        case VertexOrdering::Bfs:
+        {
+            tbb::parallel_sort(order.begin(), order.end(), byDegreeDescending);
+            order = bfsVertexOrder(g, order, [] (VertexId, VertexId) {return false;});
+            break;
+        }
+        case VertexOrdering::HubCluster:
+        {
+            EdgeIndex averageDegree = g.nodeNum() > 0 ? g.edgeNum() / g.nodeNum() : 0;
+            std::stable_partition(order.begin(), order.end(), [&] (VertexId v) {return g.degree(v) > averageDegree;});
+            break;
+        }
+    }
+    return order;
+}
+
+// Builds the snapshot in which vertex order[i] has dense id i and translates the dense 'sources'.
+inline CsrGraph reorderGraph(const CsrGraph& g, const std::vector<VertexId>& order, std::vector<VertexId>& sources)
+{
+    VertexId nodeNumber = g.nodeNum();
+    std::vector<VertexId> newIds(nodeNumber);
+    tbb::parallel_for(tbb::blocked_range<VertexId>(0, nodeNumber), [&] (const tbb::blocked_range<VertexId>& r) {
+        for(VertexId i = r.begin(); i != r.end(); ++i)
+        {
+            newIds[order[i]] = i;
+        }
+    });
+
+    std::vector<EdgeIndex> offsets(nodeNumber + 1, 0);
+    for(VertexId i = 0; i < nodeNumber; ++i)
+    {
+        offsets[i + 1] = offsets[i] + g.degree(order[i]);
+    }
+
+    std::vector<VertexId> neighbours(g.edgeNum());
+    std::vector<std::uint64_t> originalIds(nodeNumber);
+    std::vector<VertexId> denseIds(g.denseIdData(), g.denseIdData() + g.maxNodeId() + 1);
+    tbb::parallel_for(tbb::blocked_range<VertexId>(0, nodeNumber), [&] (const tbb::blocked_range<VertexId>& r) {
+        for(VertexId i = r.begin(); i != r.end(); ++i)
+        {
+            VertexId old = order[i];
+            VertexId* position = neighbours.data() + offsets[i];
+            for(const VertexId* e = g.neighboursBegin(old); e != g.neighboursEnd(old); ++e)
+            {
+                *position++ = newIds[*e];
+            }
+            // ascending neighbour ids, so that an adjacency walks the labels front to back
+            std::sort(neighbours.data() + offsets[i], position);
+            originalIds[i] = g.originalId(old);
+            denseIds[g.originalId(old)] = i;
+        }
+    });
+
+    for(VertexId& s: sources)
+    {
+        s = newIds[s];
+    }
+    return CsrGraph(std::move(offsets), std::move(neighbours), std::move(originalIds), std::move(denseIds), g.maxNodeId());
+}
+
+inline CsrGraph reorderGraph(const CsrGraph& g, VertexOrdering ordering, std::vector<VertexId>& sources)
+{
+    return reorderGraph(g, computeVertexOrder(g, ordering), sources);
+}
+
+#endif
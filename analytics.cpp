@@ -0,0 +1,307 @@
+#include "Analytics.h"
+#include "DistanceFile.h"
+#include "GraphFile.h"
+#include "EdgeListReader.h"
+#include "IncrementalMsBfs.h"
+
+#include <chrono>
+#include <iostream>
+
+// Closeness centrality, eccentricity and all-pairs distances of a graph (see Analytics.h).
+//
+//   analytics [-k samples] [--seed n] [-b baseline_sources] [-e] closeness|eccentricity|apsp graph
+//
+// The graph is a binary graph file, an LGF file or, with -e, an edge list. Every vertex is a source
+// unless -k is given, then k sampled sources estimate the values of every vertex (apsp writes the rows
+// of the sample). The results go to stdout by original vertex id, one "id value" line per vertex
+// ("source target distance" per reachable pair for apsp). The time of the analytic and its speedup over
+// one single-source BFS per source go to stderr; the baseline runs at most -b sources (default 1024)
+// and is extrapolated to the rest.
+//
+// With -d, apsp writes a packed distance file instead of the text lines (see DistanceFile.h), encoded
+// as -D u8 (default), u16 or planes:p. The distance command looks distances up in such a file:
+//
+//   analytics distance distances.dist source_id [vertex_id ...]   all vertices if none are given
+//
+// The update command keeps the distances from k sampled sources (default 64, at most 512) up to date
+// under -u rounds of random edge updates with -i edges each, alternating insertions and deletions (see
+// IncrementalMsBfs.h). Every round writes "round kind edges changed_distances scanned_edges
+// full_run_edges saved_edges rerun seconds" to stdout, the totals go to stderr.
+
+void usage()
+{
+    std::cout << "Usage: analytics [-k samples] [--seed n] [-b baseline_sources] [-e] closeness|eccentricity|apsp graph_file" << std::endl;
+    std::cout << "       analytics [-k samples] [-d distance_file [-D u8|u16|planes:p]] apsp graph_file" << std::endl;
+    std::cout << "       analytics distance distance_file source_id [vertex_id ...]" << std::endl;
+    std::cout << "       analytics [-k samples] [--seed n] [-u rounds] [-i edges_per_round] [-e] update graph_file" << std::endl;
+    std::cout << "       graph_file: binary graph file, LGF file, or an edge list with -e" << std::endl;
+    exit(1);
+}
+
+CsrGraph loadAnalyticsGraph(const std::string& path, bool edgeList)
+{
+    std::vector<VertexId> sources;
+    if(edgeList)
+    {
+        EdgeListStats stats;
+        return readEdgeList(path, EdgeListOptions(), stats);
+    }
+    if(isGraphFile(path))
+    {
+        return mapGraphFile(path, sources);
+    }
+    ListGraph readInGraph;
+    GraphReader<ListGraph> reader(readInGraph, path);
+    reader.run();
+    return CsrGraph(readInGraph);
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// returns the time of the traversal, writing the matrix not included
+double writeAllPairs(const CsrGraph& g, const std::vector<VertexId>& sources)
+{
+    return withLabelWidth(sources.size(), [&] (auto width) {
+        const unsigned int bitsetSize = decltype(width)::value;
+        auto start = std::chrono::steady_clock::now();
+        DistanceMatrixSink<bitsetSize> matrix(g, sources.size());
+        allPairsDistances(g, sources, matrix);
+        double seconds = secondsSince(start);
+        for(std::size_t i = 0; i < sources.size(); ++i)
+        {
+            const typename DistanceMatrixSink<bitsetSize>::Distance* row = matrix.row(i);
+            for(VertexId v = 0; v < g.nodeNum(); ++v)
+            {
+                if(row[v] != DistanceMatrixSink<bitsetSize>::UNREACHED)
+                {
+                    std::cout << g.originalId(sources[i]) << ' ' << g.originalId(v) << ' ' << row[v] << '\n';
+                }
+            }
+        }
+        return seconds;
+    });
+}
+
+// returns the time of the traversal, which writes the file as it goes
+double writeDistanceFile(const CsrGraph& g, const std::vector<VertexId>& sources, const std::string& path,
+                         DistanceEncoding encoding, std::uint32_t planeNum)
+{
+    return withLabelWidth(sources.size(), [&] (auto width) {
+        const unsigned int bitsetSize = decltype(width)::value;
+        auto start = std::chrono::steady_clock::now();
+        DistanceFileSink<bitsetSize> sink(path, g, sources, encoding, planeNum);
+        MsBfs<bitsetSize, DistanceFileSink<bitsetSize>> engine(g);
+        engine.hybridMsPbfs(sources, sink);
+        sink.finish();
+        double seconds = secondsSince(start);
+        std::cerr << "wrote " << sink.fileSize() << " bytes to " << path << " ("
+                  << 8.0 * sink.fileSize() / (double(sources.size()) * g.nodeNum()) << " bits per pair)" << std::endl;
+        return seconds;
+    });
+}
+
+// prints the distances of the given vertices (all if there are none) from a source of a distance file
+void queryDistances(const std::vector<std::string>& args)
+{
+    DistanceFile file(args[1]);
+    std::size_t source = file.sourceIndex(std::stoull(args[2]));
+    if(source == file.sourceNum())
+    {
+        throw std::runtime_error(args[2] + " is not a source of " + args[1]);
+    }
+    auto write = [&] (std::size_t column) {
+        std::uint32_t d = file.distance(source, column);
+        std::cout << file.vertexId(column) << ' ';
+        if(d == DistanceFile::UNREACHED)
+        {
+            std::cout << "unreached\n";
+        }
+        else
+        {
+            std::cout << d << '\n';
+        }
+    };
+    if(args.size() == 3)
+    {
+        for(std::size_t column = 0; column < file.nodeNum(); ++column)
+        {
+            write(column);
+        }
+    }
+    for(std::size_t i = 3; i < args.size(); ++i)
+    {
+        std::size_t column = file.vertexColumn(std::stoull(args[i]));
+        if(column == file.nodeNum())
+        {
+            throw std::runtime_error(args[i] + " is not a vertex of " + args[1]);
+        }
+        write(column);
+    }
+}
+
+// random edge updates on the distances from 'sources', one insertion and one deletion round after another
+void runUpdates(const CsrGraph& g, const std::vector<VertexId>& sources, std::size_t rounds, std::size_t edgesPerRound, std::uint64_t seed)
+{
+    withLabelWidth(sources.size(), [&] (auto width) {
+        const unsigned int bitsetSize = decltype(width)::value;
+        IncrementalMsBfs<bitsetSize> incremental(g, sources);
+        std::mt19937_64 random(seed);
+        std::uniform_int_distribution<VertexId> vertex(0, g.nodeNum() - 1);
+        for(std::size_t round = 0; round < rounds; ++round)
+        {
+            bool insertion = round % 2 == 0;
+            std::vector<IncrementalEdge> edges;
+            for(std::size_t i = 0; i < edgesPerRound; ++i)
+            {
+                VertexId u = vertex(random);
+                if(insertion)
+                {
+                    edges.emplace_back(u, vertex(random));
+                }
+                else if(g.degree(u) > 0)
+                {
+                    // an edge of the base graph, ignored if an earlier round deleted it already
+                    edges.emplace_back(u, g.neighboursBegin(u)[random() % g.degree(u)]);
+                }
+            }
+            UpdateStats stats = insertion ? incremental.insertEdges(edges) : incremental.deleteEdges(edges);
+            std::cout << round << ' ' << (insertion ? "insert" : "delete") << ' ' << stats.edges << ' '
+                      << stats.changedDistances << ' ' << stats.scannedEdges << ' ' << stats.fullRunEdges << ' '
+                      << stats.savedEdges() << ' ' << stats.rerun << ' ' << stats.seconds << '\n';
+        }
+        const IncrementalStats& totals = incremental.getStats();
+        std::cerr << totals.updates << " updates, " << totals.reruns << " full reruns, " << totals.scannedEdges
+                  << " adjacency entries scanned, " << totals.savedEdges << " saved against full runs" << std::endl;
+    });
+}
+
+template <typename Value>
+void writeValues(const CsrGraph& g, const std::vector<Value>& values)
+{
+    for(VertexId v = 0; v < g.nodeNum(); ++v)
+    {
+        std::cout << g.originalId(v) << ' ' << values[v] << '\n';
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args(argv + 1, argv + argc);
+    std::size_t samples = 0;
+    std::uint64_t seed = 1;
+    std::size_t baselineLimit = 1024;
+    bool edgeList = false;
+    std::string distancePath;
+    DistanceEncoding encoding = DistanceEncoding::Depth8;
+    std::uint32_t planeNum = 0;
+    std::size_t rounds = 10;
+    std::size_t edgesPerRound = 16;
+    if(args.size() >= 3 && args[0] == "distance")
+    {
+        queryDistances(args);
+        return 0;
+    }
+    while(args.size() > 2 && args[0][0] == '-')
+    {
+        if(args[0] == "-e")
+        {
+            edgeList = true;
+            args.erase(args.begin());
+            continue;
+        }
+        if(args[0] == "-k")
+        {
+            samples = std::stoull(args[1]);
+        }
+        else if(args[0] == "--seed")
+        {
+            seed = std::stoull(args[1]);
+        }
+        else if(args[0] == "-b")
+        {
+            baselineLimit = std::stoull(args[1]);
+        }
+        else if(args[0] == "-d")
+        {
+            distancePath = args[1];
+        }
+        else if(args[0] == "-D")
+        {
+            encoding = parseDistanceEncoding(args[1], planeNum);
+        }
+        else if(args[0] == "-u")
+        {
+            rounds = std::stoull(args[1]);
+        }
+        else if(args[0] == "-i")
+        {
+            edgesPerRound = std::stoull(args[1]);
+        }
+        else
+        {
+            usage();
+        }
+        args.erase(args.begin(), args.begin() + 2);
+    }
+    if(args.size() != 2 || (args[0] != "closeness" && args[0] != "eccentricity" && args[0] != "apsp" && args[0] != "update"))
+    {
+        usage();
+    }
+
+    CsrGraph g = loadAnalyticsGraph(args[1], edgeList);
+    std::cerr << "loaded " << g.nodeNum() << " nodes, " << g.edgeNum() / 2 << " edges" << std::endl;
+    if(args[0] == "update")
+    {
+        runUpdates(g, sampleSources(g, samples > 0 ? samples : 64, seed), rounds, edgesPerRound, seed);
+        return 0;
+    }
+    std::vector<VertexId> sources = samples > 0 ? sampleSources(g, samples, seed) : allVertices(g);
+
+    // the time of the analytic alone, writing the results is not included
+    double seconds = 0;
+    if(args[0] == "closeness")
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<double> values = samples > 0 ? approximateClosenessCentrality(g, samples, seed) : closenessCentrality(g);
+        seconds = secondsSince(start);
+        writeValues(g, values);
+    }
+    else if(args[0] == "eccentricity")
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::uint32_t> values;
+        DiameterBounds diameter{0, 0};
+        if(samples > 0)
+        {
+            values = approximateEccentricities(g, samples, seed, diameter);
+        }
+        else
+        {
+            values = eccentricities(g);
+            diameter.lower = diameter.upper = values.empty() ? 0 : *std::max_element(values.begin(), values.end());
+        }
+        seconds = secondsSince(start);
+        std::cerr << "diameter " << diameter.lower;
+        if(diameter.upper != diameter.lower)
+        {
+            std::cerr << " to " << diameter.upper;
+        }
+        std::cerr << std::endl;
+        writeValues(g, values);
+    }
+    else
+    {
+        seconds = distancePath.empty() ? writeAllPairs(g, sources) : writeDistanceFile(g, sources, distancePath, encoding, planeNum);
+    }
+
+    SpeedupMeasurement speedup = measureSpeedup(g, sources, seconds, baselineLimit);
+    std::cerr << args[0] << (samples > 0 ? " (approximate, " + std::to_string(sources.size()) + " sources)" : std::string())
+              << " in " << speedup.msbfsSeconds << " s, single-source BFS " << speedup.baselineSeconds << " s"
+              << (speedup.extrapolated ? " (extrapolated from " + std::to_string(speedup.baselineSources) + " sources)" : std::string())
+              << ", speedup " << speedup.speedup() << std::endl;
+    return 0;
+}
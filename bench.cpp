@@ -0,0 +1,392 @@
+// operator new is replaced here to count the allocations of the runs, see AllocationCounter.h
+#define MSBFS_COUNT_ALLOCATIONS
+#include "AllocationCounter.h"
+#include "MsPbfs.h"
+#include "SerialMsBfs.h"
+#include "GraphGenerators.h"
+
+#include <sys/resource.h>
+
+#include <iomanip>
+#include <sstream>
+
+#include "tbb/task_arena.h"
+
+// Benchmark of the MS-BFS variants on synthetic graphs (see GraphGenerators.h).
+// Every combination of generator, scale, source count and thread count is run 'trials' times per
+// algorithm and written as one CSV line to stdout:
+//
+//   wall time     mean, sample standard deviation and minimum over the trials, in seconds
+//   GTEPS         traversed undirected edges (summed over the sources) / mean time, i.e. the harmonic
+//                 mean of the per-trial rates as in Graph500, and the same for the fastest trial
+//   peak RSS      high-water mark of the process after the runs, in MiB
+//   allocations   operator new calls per run; the engine carves its run state from an arena, so with the
+//                 discarding sink this is 0 for the parallel algorithms
+//   arena         bytes the engine reserved for its run state, in MiB (0 for the serial algorithms)
+//
+// The label width is the narrowest that takes all sources of a configuration in one batch (up to 512
+// bits, see withLabelWidth). The parallel algorithms run once per memory placement of the engine (see
+// NumaPlacement.h), the bytes the kernel actually placed go to stderr. The serial algorithms depend on
+// neither the thread count nor the placement, they are run once per source count.
+// With --max-memory, the parallel configurations whose engine would take more than the budget (labels and
+// run arena, see MsBfs::memoryBytes) are refused with a note on stderr instead of being run.
+
+enum class BenchAlgorithm
+{
+    SerialTopDown = 0,
+    SerialBottomUp,
+    TopDown,
+    BottomUp,
+    Hybrid
+};
+
+const BenchAlgorithm allBenchAlgorithms[] = {BenchAlgorithm::SerialTopDown, BenchAlgorithm::SerialBottomUp,
+                                             BenchAlgorithm::TopDown, BenchAlgorithm::BottomUp, BenchAlgorithm::Hybrid};
+
+const char* benchAlgorithmName(BenchAlgorithm algorithm)
+{
+    switch(algorithm)
+    {
+        case BenchAlgorithm::SerialTopDown: return "serial-td";
+        case BenchAlgorithm::SerialBottomUp: return "serial-bu";
+        case BenchAlgorithm::TopDown: return "td";
+        case BenchAlgorithm::BottomUp: return "bu";
+        case BenchAlgorithm::Hybrid: return "hybrid";
+    }
+    return "unknown";
+}
+
+BenchAlgorithm parseBenchAlgorithm(const std::string& name)
+{
+    for(BenchAlgorithm algorithm: allBenchAlgorithms)
+    {
+        if(name == benchAlgorithmName(algorithm))
+        {
+            return algorithm;
+        }
+    }
+    throw std::runtime_error("unknown algorithm " + name + " (serial-td, serial-bu, td, bu or hybrid)");
+}
+
+bool isSerial(BenchAlgorithm algorithm)
+{
+    return algorithm == BenchAlgorithm::SerialTopDown || algorithm == BenchAlgorithm::SerialBottomUp;
+}
+
+struct BenchOptions
+{
+    std::vector<GraphGenerator> generators{GraphGenerator::Rmat};
+    std::vector<unsigned int> scales{16};
+    std::vector<std::size_t> sourceCounts{64};
+    std::vector<int> threadCounts{tbb::this_task_arena::max_concurrency()};
+    std::vector<BenchAlgorithm> algorithms{std::begin(allBenchAlgorithms), std::end(allBenchAlgorithms)};
+    std::vector<NumaPlacement> placements{NumaPlacement::Naive};
+    unsigned int edgeFactor = 16;
+    std::size_t trials = 5;
+    std::uint64_t seed = 1;
+    std::size_t maxMemory = 0; // bytes, 0 for no limit
+};
+
+struct TrialStats
+{
+    double meanSeconds;
+    double stddevSeconds;
+    double minSeconds;
+};
+
+TrialStats trialStats(const std::vector<double>& seconds)
+{
+    double sum = 0;
+    for(double s: seconds)
+    {
+        sum += s;
+    }
+    double mean = sum / seconds.size();
+    double squares = 0;
+    for(double s: seconds)
+    {
+        squares += (s - mean) * (s - mean);
+    }
+    double stddev = seconds.size() > 1 ? std::sqrt(squares / (seconds.size() - 1)) : 0;
+    return TrialStats{mean, stddev, *std::min_element(seconds.begin(), seconds.end())};
+}
+
+double peakRssMegabytes()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0; // kilobytes on Linux
+}
+
+template <typename Function>
+double timed(Function f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// the serial algorithms take one label of sources at a time
+template <unsigned int bitsetSize, typename Serial>
+void runSerialBatches(const std::vector<VertexId>& sources, Serial serial)
+{
+    for(std::size_t first = 0; first < sources.size(); first += bitsetSize)
+    {
+        std::vector<VertexId> batch(sources.begin() + first, sources.begin() + std::min<std::size_t>(sources.size(), first + bitsetSize));
+        serial(batch);
+    }
+}
+
+// one run of a serial algorithm, they take no engine
+template <unsigned int bitsetSize>
+double runSerial(BenchAlgorithm algorithm, const CsrGraph& g, const std::vector<VertexId>& sources)
+{
+    auto discard = [] (std::size_t, std::size_t, std::size_t, std::size_t, const std::bitset<bitsetSize>&) {};
+    if(algorithm == BenchAlgorithm::SerialTopDown)
+    {
+        return timed([&] {
+            runSerialBatches<bitsetSize>(sources, [&] (const std::vector<VertexId>& batch) {TopDownMsBfs<bitsetSize>(g, batch, discard);});
+        });
+    }
+    return timed([&] {
+        runSerialBatches<bitsetSize>(sources, [&] (const std::vector<VertexId>& batch) {BottomUpMsBfs<bitsetSize>(g, batch, discard);});
+    });
+}
+
+// one run of a parallel algorithm; the engine is built outside of the timed region, like the graph
+template <unsigned int bitsetSize>
+double runParallel(BenchAlgorithm algorithm, const std::vector<VertexId>& sources, MsBfs<bitsetSize, DiscardSink<bitsetSize>>& engine)
+{
+    DiscardSink<bitsetSize> sink;
+    switch(algorithm)
+    {
+        case BenchAlgorithm::TopDown:
+            return timed([&] {engine.topDownMsPbfs(sources, sink);});
+        case BenchAlgorithm::BottomUp:
+            return timed([&] {engine.bottomUpMsPbfs(sources, sink);});
+        default:
+            return timed([&] {engine.hybridMsPbfs(sources, sink);});
+    }
+}
+
+// Undirected edges the searches from 'sources' traverse, the same for every algorithm: a search
+// traverses the adjacency of the component of its source. The components come from one plain BFS
+// each, so that counting needs no engine (and no more memory than a configuration --max-memory refuses).
+std::uint64_t traversedEdges(const CsrGraph& g, const std::vector<VertexId>& sources)
+{
+    std::vector<VertexId> component(g.nodeNum(), INVALID_VERTEX);
+    std::vector<EdgeIndex> componentEntries;
+    std::vector<VertexId> queue;
+    std::uint64_t entries = 0;
+    for(VertexId s: sources)
+    {
+        if(component[s] == INVALID_VERTEX)
+        {
+            component[s] = componentEntries.size();
+            componentEntries.push_back(0);
+            queue.assign(1, s);
+            for(std::size_t head = 0; head < queue.size(); ++head)
+            {
+                VertexId v = queue[head];
+                componentEntries.back() += g.degree(v);
+                for(const VertexId* e = g.neighboursBegin(v); e != g.neighboursEnd(v); ++e)
+                {
+                    if(component[*e] == INVALID_VERTEX)
+                    {
+                        component[*e] = component[s];
+                        queue.push_back(*e);
+                    }
+                }
+            }
+        }
+        entries += componentEntries[component[s]];
+    }
+    return entries / 2;
+}
+
+void benchmarkGraph(const BenchOptions& options, GraphGenerator generator, unsigned int scale)
+{
+    GeneratorOptions generatorOptions;
+    generatorOptions.generator = generator;
+    generatorOptions.scale = scale;
+    generatorOptions.edgeFactor = options.edgeFactor;
+    generatorOptions.seed = options.seed;
+    CsrGraph g = generateGraph(generatorOptions);
+    std::cerr << graphGeneratorName(generator) << " scale " << scale << ": " << g.nodeNum() << " nodes, "
+              << g.edgeNum() / 2 << " edges" << std::endl;
+
+    for(std::size_t sourceCount: options.sourceCounts)
+    {
+        std::vector<VertexId> sources = sampleSources(g, sourceCount, options.seed + sourceCount);
+        withLabelWidth(sources.size(), [&] (auto width) {
+            const unsigned int bitsetSize = decltype(width)::value;
+            std::uint64_t edges = traversedEdges(g, sources);
+            // runs an algorithm 'trials' times and writes its CSV line
+            auto measure = [&] (BenchAlgorithm algorithm, int threads, NumaPlacement placement, std::size_t arenaBytes, auto run) {
+                std::vector<double> seconds;
+                std::uint64_t allocations = 0;
+                for(std::size_t trial = 0; trial < options.trials; ++trial)
+                {
+                    std::uint64_t before = heapAllocationNum().load();
+                    double runSeconds = run();
+                    allocations += heapAllocationNum().load() - before;
+                    seconds.push_back(runSeconds);
+                }
+                allocations /= options.trials;
+                TrialStats stats = trialStats(seconds);
+                std::cout << graphGeneratorName(generator) << ',' << scale << ',' << g.nodeNum() << ',' << g.edgeNum() / 2 << ','
+                          << benchAlgorithmName(algorithm) << ',' << threads << ',' << numaPlacementName(placement) << ','
+                          << sources.size() << ',' << bitsetSize << ',' << options.trials << ',' << edges << ','
+                          << stats.meanSeconds << ',' << stats.stddevSeconds << ',' << stats.minSeconds << ','
+                          << edges / stats.meanSeconds / 1e9 << ',' << edges / stats.minSeconds / 1e9 << ','
+                          << peakRssMegabytes() << ',' << allocations << ',' << arenaBytes / 1048576.0 << std::endl;
+            };
+
+            // the serial algorithms build no engine, so the budget does not apply to them
+            for(BenchAlgorithm algorithm: options.algorithms)
+            {
+                if(isSerial(algorithm))
+                {
+                    measure(algorithm, 1, NumaPlacement::Naive, 0, [&] {return runSerial<bitsetSize>(algorithm, g, sources);});
+                }
+            }
+
+            for(int threads: options.threadCounts)
+            {
+                tbb::task_arena arena(threads);
+                arena.execute([&] {
+                    for(NumaPlacement placement: options.placements)
+                    {
+                        if(!MsBfs<bitsetSize, DiscardSink<bitsetSize>>::fitsMemoryBudget(g, threads, options.maxMemory))
+                        {
+                            std::cerr << "refusing " << sources.size() << " sources (" << bitsetSize << " bit labels) on " << threads
+                                      << " threads: the engine needs "
+                                      << MsBfs<bitsetSize, DiscardSink<bitsetSize>>::memoryBytes(g, threads) / 1048576.0
+                                      << " MiB, the budget is " << options.maxMemory / 1048576.0 << " MiB" << std::endl;
+                            continue;
+                        }
+                        MsBfs<bitsetSize, DiscardSink<bitsetSize>> engine(g, placement, options.maxMemory);
+                        if(placement != NumaPlacement::Naive)
+                        {
+                            std::cerr << numaPlacementName(placement) << " placement, " << threads << " threads: "
+                                      << engine.placedBytes() << " bytes placed" << std::endl;
+                        }
+                        for(BenchAlgorithm algorithm: options.algorithms)
+                        {
+                            if(!isSerial(algorithm))
+                            {
+                                measure(algorithm, threads, placement, engine.arenaBytes(),
+                                        [&] {return runParallel<bitsetSize>(algorithm, sources, engine);});
+                            }
+                        }
+                    }
+                });
+            }
+        });
+    }
+}
+
+template <typename T, typename Parse>
+std::vector<T> parseList(const std::string& list, Parse parse)
+{
+    std::vector<T> values;
+    std::istringstream stream(list);
+    std::string item;
+    while(std::getline(stream, item, ','))
+    {
+        values.push_back(parse(item));
+    }
+    if(values.empty())
+    {
+        throw std::runtime_error("empty list");
+    }
+    return values;
+}
+
+void usage()
+{
+    std::cout << "Usage: bench [-g rmat,er,grid] [-s scales] [-e edge_factor] [-k source_counts] [-t thread_counts]" << std::endl;
+    std::cout << "             [-a serial-td,serial-bu,td,bu,hybrid] [-p naive,local,interleaved] [-r trials] [--seed n]" << std::endl;
+    std::cout << "             [--max-memory MiB]" << std::endl;
+    std::cout << "       lists are comma separated, e.g. -s 14,16,18 -k 64,256 -t 1,2,4,8" << std::endl;
+    exit(1);
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args(argv + 1, argv + argc);
+    BenchOptions options;
+    try
+    {
+        for(std::size_t i = 0; i < args.size(); i += 2)
+        {
+            if(i + 1 >= args.size())
+            {
+                usage();
+            }
+            const std::string& value = args[i + 1];
+            if(args[i] == "-g")
+            {
+                options.generators = parseList<GraphGenerator>(value, parseGraphGenerator);
+            }
+            else if(args[i] == "-s")
+            {
+                options.scales = parseList<unsigned int>(value, [] (const std::string& s) {return unsigned(std::stoul(s));});
+            }
+            else if(args[i] == "-e")
+            {
+                options.edgeFactor = std::stoul(value);
+            }
+            else if(args[i] == "-k")
+            {
+                options.sourceCounts = parseList<std::size_t>(value, [] (const std::string& s) {return std::size_t(std::stoull(s));});
+            }
+            else if(args[i] == "-t")
+            {
+                options.threadCounts = parseList<int>(value, [] (const std::string& s) {return std::max(1, std::stoi(s));});
+            }
+            else if(args[i] == "-a")
+            {
+                options.algorithms = parseList<BenchAlgorithm>(value, parseBenchAlgorithm);
+            }
+            else if(args[i] == "-p")
+            {
+                options.placements = parseList<NumaPlacement>(value, parseNumaPlacement);
+            }
+            else if(args[i] == "-r")
+            {
+                options.trials = std::max<std::size_t>(1, std::stoull(value));
+            }
+            else if(args[i] == "--seed")
+            {
+                options.seed = std::stoull(value);
+            }
+            else if(args[i] == "--max-memory")
+            {
+                options.maxMemory = std::stoull(value) * 1048576;
+            }
+            else
+            {
+                usage();
+            }
+        }
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        usage();
+    }
+
+    std::cout << "graph,scale,nodes,edges,algorithm,threads,placement,sources,label_bits,trials,traversed_edges,"
+                 "time_mean,time_stddev,time_min,gteps,gteps_max,peak_rss_mb,allocations,arena_mb" << std::endl;
+    std::cout << std::setprecision(6);
+    for(GraphGenerator generator: options.generators)
+    {
+        for(unsigned int scale: options.scales)
+        {
+            benchmarkGraph(options, generator, scale);
+        }
+    }
+    return 0;
+}
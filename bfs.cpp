@@ -1,15 +1,21 @@
 
 #include "MsPbfs.h"
+#include "SerialMsBfs.h"
+#include "GraphFile.h"
+#include "QueryServer.h"
+#include "ExternalMsBfs.h"
 
 
 
 //#include <lemon/bfs.h>
  
 const std::size_t sourceNum = 3;
+// sources per batch of the query server mode, one label word
+const unsigned int serverBatchSize = 64;
   
  
 template <unsigned int bitsetSize>
-void printNodeFound(std::size_t level, std::size_t nodeId, std::size_t maxNodeId, std::bitset<bitsetSize> foundIn)
+void printNodeFound(std::size_t level, std::size_t nodeId, std::size_t maxNodeId, std::size_t firstSource, std::bitset<bitsetSize> foundIn)
 {
     std::cout << nodeId << " is found on level\t" << level << "\tin the following BFS(s):\t"; // we want to reverse ids so we see those of the original graph
     //std::cout << nodeId + 1 << " is found on level\t" << level << "\tin the following BFS(s):\t";
@@ -17,224 +23,309 @@ void printNodeFound(std::size_t level, std::size_t nodeId, std::size_t maxNodeId
     {
         if(foundIn[i])
         {
-            std::cout << i + 1 << " ";
+            std::cout << firstSource + i + 1 << " ";
         }
     }
-    std::cout << std::endl;
+    std::cout << '\n';
 }
 
  
-template <unsigned int bitsetSize>
-void TopDownMsBfs(const ListGraph& g, const std::vector<Node>& sources, std::function<PrintFunctionType<bitsetSize>> callback)
+void printBottomUpStats(const BottomUpStats& stats)
 {
-    // during the loop we always use the previous 'next' as the new 'frontier'. To avoid data copying we are simply swapping two maps in each iteration.
-    ListGraph::NodeMap<Label<bitsetSize>> map1(g, 0); // we use map1 as the frontier at first
-    ListGraph::NodeMap<Label<bitsetSize>> map2(g, 0);
-    ListGraph::NodeMap<Label<bitsetSize>> seen(g, 0);
-   
-    // initializing start nodes
-    for(std::size_t i = 0; i < sources.size(); ++i)
-    {
-        Node s = sources[i];
-        map1[s][i] = 1; // set frontier for sources
-        seen[s][i] = 1; // set seen for sources
-    }
-     
-    bool foundNewNode = true;
-    std::size_t iterationNum = 1;
-   
-    while(foundNewNode)
+    std::cerr << "bottom-up: " << stats.skippedEdges << " of " << stats.checkedEdges + stats.skippedEdges
+              << " edges skipped (" << stats.skippedRatio() * 100 << "%)" << std::endl;
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void TopDownMsPBfs(MsBfs<bitsetSize, Sink>& msbfs, const std::vector<VertexId>& sources, Sink& sink)
+{
+    msbfs.topDownMsPbfs(sources, sink);
+    ScatterStats stats = msbfs.getScatterStats();
+    std::cerr << "top-down scatter: " << stats.atomicUpdates << " atomic updates, " << stats.skippedUpdates << " avoided, "
+              << stats.bufferedUpdates << " buffered" << std::endl;
+    std::cerr << "top-down: " << msbfs.getLevelNum() << " levels, " << msbfs.getBarrierNum() << " parallel passes" << std::endl;
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void BottomUpMsPBfs(MsBfs<bitsetSize, Sink>& msbfs, const std::vector<VertexId>& sources, Sink& sink)
+{
+    msbfs.bottomUpMsPbfs(sources, sink);
+    printBottomUpStats(msbfs.getBottomUpStats());
+}
+
+template <unsigned int bitsetSize, typename Sink>
+void HybridMsPBfs(MsBfs<bitsetSize, Sink>& msbfs, const std::vector<VertexId>& sources, Sink& sink)
+{
+    msbfs.hybridMsPbfs(sources, sink);
+    std::cerr << "hybrid: " << msbfs.getLevelNum() << " levels, " << msbfs.getBarrierNum() << " parallel passes" << std::endl;
+    printBottomUpStats(msbfs.getBottomUpStats());
+}
+ 
+// Reads the graph and its sources from a binary graph file (mapped, see GraphFile.h) or an LGF file.
+// note: sources are marked in lgf file (source1, source2, source3, ...)
+CsrGraph loadGraph(const std::string& path, std::vector<VertexId>& sources, VertexOrdering& ordering)
+{
+    ordering = VertexOrdering::Original;
+    if(isGraphFile(path))
     {
-        // these parts were omitted from the paper:
-        //  condition for the loop: we check whether we found any new nodes last time (if not then we can have at most one additional round but still way cheaper than checking each bit in each round) - this is a small deviation from the original algorithm
-        //  we have to use the previous 'next' as the new 'frontier'
-        //  have to set all 'next' values to 0
-        foundNewNode = false;
-       
-        ListGraph::NodeMap<Label<bitsetSize>>& frontier = (iterationNum % 2 == 1 ? map1 : map2);
-        ListGraph::NodeMap<Label<bitsetSize>>& next     = (iterationNum % 2 == 0 ? map1 : map2);
-       
-        for(typename ListGraph::NodeIt v(g); v != INVALID; ++v)
-        {
-            next[v].reset();
-        }
-       
-        // body of the algorithm (Listing 1)
-        for (typename ListGraph::NodeIt v(g); v != INVALID; ++v)
-        {
-            if(frontier[v].none())
-            {
-                continue;
-            }
-           
-            for (ListGraph::IncEdgeIt e(g, v); e!=INVALID; ++e) //iterating edges starting from v
-            {
-                Node neighbour = g.runningNode(e); // 'other' end of edge (ie neighbours)
-                next[neighbour] |= frontier[v];
-            }
-        }
-       
-        for (typename ListGraph::NodeIt v(g); v != INVALID; ++v)
+        CsrGraph g = mapGraphFile(path, sources, &ordering);
+        if(sources.size() > sourceNum)
         {
-            if(next[v].none())
-            {
-                continue;
-            }
-           
-            next[v] &= ~(seen[v]);
-            seen[v] |= next[v];
-           
-            if(next[v].any())
-            {
-                callback(iterationNum, g.id(v), g.maxNodeId(), next[v]);
-                foundNewNode = true;
-            }
+            sources.resize(sourceNum);
         }
-       
-        ++iterationNum;
+        return g;
     }
+
+    // read in and initialize graph structure (graph, sources, node labels)
+    ListGraph readInGraph;
+
+    std::vector<Node> sourceNodes(sourceNum);
    
+    GraphReader<ListGraph> reader(readInGraph, path);
+    for(std::size_t i = 1; i <= sourceNum; ++i)
+    {
+        std::string attributeName = "source" + std::to_string(i);
+        reader.node(attributeName, sourceNodes[i - 1]); // read ith source into sources
+    }
+    reader.run();
+
+    CsrGraph g(readInGraph);
+    for(auto s: sourceNodes)
+    {
+        sources.push_back(g.denseId(readInGraph.id(s)));
+    }
+    return g;
 }
 
-template <unsigned int bitsetSize>
-void BottomUpMsBfs(const ListGraph& g, const std::vector<Node>& sources, std::function<PrintFunctionType<bitsetSize>> callback)
+// Answers queries from stdin, or from the clients of a Unix socket when a path is given (see QueryServer.h).
+void serveQueries(const CsrGraph& g, double windowMilliseconds, const std::string& socketPath, std::size_t maxMemory)
 {
-    // during the loop we always use the previous 'next' as the new 'frontier'. To avoid data copying we are simply swapping two maps in each iteration.
-    ListGraph::NodeMap<Label<bitsetSize>> map1(g, 0); // we use map1 as the frontier at first
-    ListGraph::NodeMap<Label<bitsetSize>> map2(g, 0);
-    ListGraph::NodeMap<Label<bitsetSize>> seen(g, 0);
-   
-    // initializing start nodes
-    for(std::size_t i = 0; i < sources.size(); ++i)
+    QueryServer<serverBatchSize> server(g, std::chrono::microseconds(std::int64_t(windowMilliseconds * 1000)), maxMemory);
+    if(socketPath.empty())
     {
-        Node s = sources[i];
-        map1[s][i] = 1; // set frontier for sources
-        seen[s][i] = 1; // set seen for sources
+        std::shared_ptr<QueryConnection> output = std::make_shared<QueryConnection>(STDOUT_FILENO, false);
+        std::thread reader([&] {
+            server.readRequests(STDIN_FILENO, output);
+            server.shutdown();
+        });
+        server.run();
+        reader.join();
     }
-     
-    bool foundNewNode = true;
-    std::size_t iterationNum = 1;
-   
-    while(foundNewNode)
+    else
+    {
+        std::cerr << "listening on " << socketPath << std::endl;
+        server.listenUnixSocket(socketPath);
+    }
+
+    QueryServerStats stats = server.getStats();
+    std::cerr << "served " << stats.queries << " queries in " << stats.batches << " batches (" << stats.sourcesPerBatch
+              << " sources/batch), p50 " << stats.p50Milliseconds << " ms, p99 " << stats.p99Milliseconds << " ms, "
+              << stats.queriesPerSecond << " queries/s" << std::endl;
+}
+
+// Semi-external run over every source of a binary graph file (see ExternalMsBfs.h): one line per level
+// with the bytes read from the adjacency, then the vertices each source reached.
+void runExternal(const std::string& path, std::size_t partitionBytes)
+{
+    if(!isGraphFile(path))
     {
-        foundNewNode = false;
-       
-        ListGraph::NodeMap<Label<bitsetSize>>& frontier = (iterationNum % 2 == 1 ? map1 : map2);
-        ListGraph::NodeMap<Label<bitsetSize>>& next     = (iterationNum % 2 == 0 ? map1 : map2);
-       
-        for(typename ListGraph::NodeIt v(g); v != INVALID; ++v)
+        throw std::runtime_error("--external needs a binary graph file (see graphconv)");
+    }
+    std::size_t fileSourceNum = readGraphFileHeader(path).sourceNum;
+    withLabelWidth(fileSourceNum, [&] (auto width) {
+        const unsigned int bitsetSize = decltype(width)::value;
+        ExternalMsBfs<bitsetSize, LevelCountSink<bitsetSize>> engine(path, partitionBytes);
+        const std::vector<VertexId>& sources = engine.fileSources();
+        if(sources.empty())
         {
-            next[v].reset();
+            throw std::runtime_error(path + " names no sources");
         }
-       
-        // body of the algorithm (Listing 2)
-        for (typename ListGraph::NodeIt v(g); v != INVALID; ++v)
+        std::cerr << engine.nodeNum() << " nodes, " << engine.edgeNum() / 2 << " edges on disk in " << engine.partitionNum()
+                  << " partitions, " << engine.residentBytes() / (1024.0 * 1024.0) << " MiB in memory" << std::endl;
+
+        LevelCountSink<bitsetSize> sink(sources.size());
+        engine.hybridMsBfs(sources, sink);
+
+        std::uint64_t totalBytes = 0;
+        std::cout << "batch level direction frontier found bytes_read partitions_read seconds" << '\n';
+        for(const ExternalLevelStats& level: engine.getLevelStats())
         {
-            if(seen[v].all())
-            {
-                continue;
-            }
-           
-            for (ListGraph::IncEdgeIt e(g, v); e!=INVALID; ++e) //iterating edges starting from v
-            {
-                Node neighbour = g.runningNode(e); // 'other' end of edge (ie neighbours)
-                next[v] |= frontier[neighbour];
-            }
-           
-            next[v] &= ~(seen[v]);
-            seen[v] |= next[v];
-           
-            if(next[v].any())
+            std::cout << level.batch << ' ' << level.level << ' ' << (level.bottomUp ? "bottom-up" : "top-down") << ' '
+                      << level.frontierNodes << ' ' << level.foundNodes << ' ' << level.bytesRead << ' '
+                      << level.partitionsRead << '/' << engine.partitionNum() << ' ' << level.seconds << '\n';
+            totalBytes += level.bytesRead;
+        }
+        for(std::size_t i = 0; i < sources.size(); ++i)
+        {
+            const std::vector<std::uint64_t>& counts = sink.levelCounts(i);
+            std::uint64_t reached = 0;
+            for(std::uint64_t count: counts)
             {
-                callback(iterationNum, g.id(v), g.maxNodeId(), next[v]);
-                foundNewNode = true;
+                reached += count;
             }
+            std::cout << "source " << engine.originalId(sources[i]) << " reached " << reached << " vertices in "
+                      << counts.size() << " levels" << '\n';
         }
-       
-        ++iterationNum;
-    }
-   
-}
- 
-template <unsigned int bitsetSize>
-void TopDownMsPBfs(const ListGraph& g, const std::vector<Node>& sources, std::function<PrintFunctionType<bitsetSize>> callback)
-{
-    MsBfs<sourceNum> msbfs(g);
-    msbfs.topDownMsPbfs(sources, callback);
+        std::cerr << totalBytes << " bytes read, " << double(totalBytes) / (engine.edgeNum() * sizeof(VertexId))
+                  << " passes over the adjacency" << std::endl;
+    });
 }
 
-template <unsigned int bitsetSize>
-void BottomUpMsPBfs(const ListGraph& g, const std::vector<Node>& sources, std::function<PrintFunctionType<bitsetSize>> callback)
+void usage()
 {
-    MsBfs<sourceNum> msbfs(g);
-    msbfs.bottomUpMsPbfs(sources, callback);
+    std::cout << "Usage: executable_name.exe [-o original|degree|rcm|bfs|hub] path_and_filename_to_input_graph" << std::endl;
+    std::cout << "       executable_name.exe [-o ordering] --serve [-w window_ms] [-u socket_path] path_and_filename_to_input_graph" << std::endl;
+    std::cout << "       -p profile.json|profile.csv writes per level records of the parallel runs (needs a build with MSBFS_PROFILE)" << std::endl;
+    std::cout << "       --max-memory MiB refuses to run when the parallel engine would take more (see MsBfs::memoryBytes)" << std::endl;
+    std::cout << "       executable_name.exe --external [-m partition_mib] path_to_binary_graph_file" << std::endl;
+    exit(1);
 }
- 
-// @param file name to lgf file
+
+// @param file name to lgf or binary graph file, optionally preceded by -o ordering (see VertexOrder.h)
+// and the options of the query server mode or the semi-external mode
 int main(int argc, char** argv)
 {
-    if(argc != 2)
+    std::vector<std::string> args(argv + 1, argv + argc);
+    VertexOrdering ordering = VertexOrdering::Original;
+    bool serve = false;
+    double windowMilliseconds = 1;
+    std::string socketPath;
+    std::string profilePath;
+    bool external = false;
+    std::size_t partitionBytes = ExternalMsBfs<64, DiscardSink<64>>::DEFAULT_PARTITION_BYTES;
+    std::size_t maxMemory = 0;
+    while(args.size() > 1 && args[0][0] == '-')
     {
-        std::cout << "Usage: executable_name.exe path_and_filename_to_input_graph";
-        exit(1);
+        if(args[0] == "--serve")
+        {
+            serve = true;
+            args.erase(args.begin());
+            continue;
+        }
+        if(args[0] == "--external")
+        {
+            external = true;
+            args.erase(args.begin());
+            continue;
+        }
+        if(args.size() < 3)
+        {
+            usage();
+        }
+        if(args[0] == "-o")
+        {
+            ordering = parseVertexOrdering(args[1]);
+        }
+        else if(args[0] == "-w")
+        {
+            windowMilliseconds = std::stod(args[1]);
+        }
+        else if(args[0] == "-u")
+        {
+            socketPath = args[1];
+        }
+        else if(args[0] == "-m")
+        {
+            partitionBytes = std::stoull(args[1]) << 20;
+        }
+        else if(args[0] == "--max-memory")
+        {
+            maxMemory = std::stoull(args[1]) << 20;
+        }
+        else if(args[0] == "-p")
+        {
+            if(!EngineProfiler::ENABLED)
+            {
+                std::cerr << "-p needs a build with MSBFS_PROFILE (make PROFILE=1)" << std::endl;
+                exit(1);
+            }
+            profilePath = args[1];
+        }
+        else
+        {
+            usage();
+        }
+        args.erase(args.begin(), args.begin() + 2);
     }
- 
-    // read in and initialize graph structure (graph, sources, node labels)
-    // note: sources are marked in lgf file (source1, source2, source3, ...)
-    ListGraph readInGraph;
-
-    std::vector<Node> sources(sourceNum);
-   
-    GraphReader<ListGraph> reader(readInGraph, argv[1]);
-    for(std::size_t i = 1; i <= sourceNum; ++i)
+    if(args.size() != 1)
     {
-        std::string attributeName = "source" + std::to_string(i);
-        reader.node(attributeName, sources[i - 1]); // read ith source into sources
+        usage();
     }
-    reader.run();
-   
-    std::cout << "TopDownMsBfs: " << std::endl;
-
-    // Top-down MS-BFS
-    { // cannot delete NodeMap from graphs so we copy the whole graph each time so that we can label it anew
-        ListGraph g;
-       
-        GraphCopy<ListGraph, ListGraph>(readInGraph, g).run();
-        std::function<PrintFunctionType<sourceNum>> callback = printNodeFound<sourceNum>;
-        TopDownMsBfs<sourceNum>(g, sources, callback);
+
+    // the adjacency stays on disk, the graph is never loaded
+    if(external)
+    {
+        runExternal(args[0], partitionBytes);
+        return 0;
     }
 
-    std::cout << "BottomUpMsBfs: " << std::endl;
+    // the snapshot is immutable and loaded once, so every algorithm below can share it
+    auto loadStart = std::chrono::steady_clock::now();
+    std::vector<VertexId> denseSources;
+    VertexOrdering fileOrdering;
+    CsrGraph g = loadGraph(args[0], denseSources, fileOrdering);
+    std::chrono::duration<double> loadTime = std::chrono::steady_clock::now() - loadStart;
+    std::cerr << "loaded " << g.nodeNum() << " nodes, " << g.edgeNum() / 2 << " edges in " << loadTime.count() << " s" << std::endl;
 
-    // Bottom Up MS-BFS
-    { 
-        ListGraph g;
-       
-        GraphCopy<ListGraph, ListGraph>(readInGraph, g).run();
-        std::function<PrintFunctionType<sourceNum>> callback = printNodeFound<sourceNum>;
-        BottomUpMsBfs<sourceNum>(g, sources, callback);
+    // graph files written with graphconv -o are already relabeled
+    if(ordering != VertexOrdering::Original && ordering != fileOrdering)
+    {
+        auto orderStart = std::chrono::steady_clock::now();
+        g = reorderGraph(g, ordering, denseSources);
+        std::chrono::duration<double> orderTime = std::chrono::steady_clock::now() - orderStart;
+        std::cerr << vertexOrderingName(ordering) << " ordering in " << orderTime.count() << " s" << std::endl;
     }
 
-    std::cout << std::endl;    
-    std::cout << "TopDownMsPBfs: " << std::endl;
-    
+    if(serve)
     {
-        ListGraph g;
-        GraphCopy<ListGraph, ListGraph>(readInGraph, g).run();
-        std::function<PrintFunctionType<sourceNum>> callback = printNodeFound<sourceNum>;
-        TopDownMsPBfs<sourceNum>(g, sources, callback);
-        
+        serveQueries(g, windowMilliseconds, socketPath, maxMemory);
+        return 0;
     }
-
-    std::cout << "BottomUpMsPBfs: " << std::endl;
-    { 
-        ListGraph g;
-        GraphCopy<ListGraph, ListGraph>(readInGraph, g).run();
-        std::function<PrintFunctionType<sourceNum>> callback = printNodeFound<sourceNum>;
-        BottomUpMsPBfs<sourceNum>(g, sources, callback);
-    }      
-   
-   
    
+    // every run below is instantiated for the narrowest label that takes all sources
+    withLabelWidth(denseSources.size(), [&] (auto width) {
+        const unsigned int bitsetSize = decltype(width)::value;
+
+        // the parallel runs share one engine, it keeps its partitions and label arrays between runs;
+        // it is built first, so that an engine over the budget refuses before any algorithm ran
+        MsBfs<bitsetSize, PrintSink<bitsetSize>> engine(g, NumaPlacement::Naive, maxMemory);
+
+        std::cout << "TopDownMsBfs: " << std::endl;
+
+        // Top-down MS-BFS
+        TopDownMsBfs<bitsetSize>(g, denseSources, printNodeFound<bitsetSize>);
+
+        std::cout << "BottomUpMsBfs: " << std::endl;
+
+        // Bottom Up MS-BFS
+        printBottomUpStats(BottomUpMsBfs<bitsetSize>(g, denseSources, printNodeFound<bitsetSize>));
+
+        std::cout << std::endl;
+
+        std::cout << "TopDownMsPBfs: " << std::endl;
+        {
+            PrintSink<bitsetSize> sink(g, std::cout);
+            TopDownMsPBfs(engine, denseSources, sink);
+        }
+
+        std::cout << "BottomUpMsPBfs: " << std::endl;
+        {
+            PrintSink<bitsetSize> sink(g, std::cout);
+            BottomUpMsPBfs(engine, denseSources, sink);
+        }
+
+        std::cout << "HybridMsPBfs: " << std::endl;
+        {
+            PrintSink<bitsetSize> sink(g, std::cout);
+            HybridMsPBfs(engine, denseSources, sink);
+        }
+
+        if(!profilePath.empty())
+        {
+            writeProfile(engine.getProfiler(), profilePath);
+            std::cerr << "profile written to " << profilePath << std::endl;
+        }
+    });
+
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,135 @@
+#include "GraphFile.h"
+#include "EdgeListReader.h"
+
+#include <chrono>
+#include <iostream>
+
+// Converts an LGF file or an edge list into the binary graph file read by bfs (see GraphFile.h).
+//
+//   graphconv [-s sourceNum] input.lgf output.graph     sources are the attributes source1, source2, ...
+//   graphconv -e edges.txt output.graph [sourceId ...]  one "u v" pair per line, '#' and '%' start comments,
+//                                                       or a Matrix Market coordinate file
+//
+// Edge lists are read in parallel (see EdgeListReader.h). Self-loops and parallel edges are dropped
+// unless --keep-self-loops or --keep-duplicates is given before -e.
+// With -o ordering the vertices are relabeled before writing (see VertexOrder.h), so that bfs
+// maps the reordered graph without paying for the reordering again.
+
+void usage()
+{
+    std::cout << "Usage: graphconv [-o ordering] [-s source_number] input.lgf output_graph_file" << std::endl;
+    std::cout << "       graphconv [-o ordering] [--keep-self-loops] [--keep-duplicates] -e edge_list.txt output_graph_file [source_id ...]" << std::endl;
+    std::cout << "       ordering: original, degree, rcm, bfs or hub" << std::endl;
+    exit(1);
+}
+
+// relabels g (and its sources) unless the original order is kept, then writes it
+void writeOrdered(const std::string& output, const CsrGraph& g, std::vector<VertexId>& sources, VertexOrdering ordering)
+{
+    if(ordering == VertexOrdering::Original)
+    {
+        writeGraphFile(output, g, sources);
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    CsrGraph reordered = reorderGraph(g, ordering, sources);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << vertexOrderingName(ordering) << " ordering in " << elapsed.count() << " s" << std::endl;
+    writeGraphFile(output, reordered, sources, ordering);
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args(argv + 1, argv + argc);
+    EdgeListOptions options;
+    VertexOrdering ordering = VertexOrdering::Original;
+    while(!args.empty() && (args[0].compare(0, 7, "--keep-") == 0 || args[0] == "-o"))
+    {
+        if(args[0] == "-o" && args.size() > 1)
+        {
+            ordering = parseVertexOrdering(args[1]);
+            args.erase(args.begin());
+        }
+        else if(args[0] == "--keep-self-loops")
+        {
+            options.removeSelfLoops = false;
+        }
+        else if(args[0] == "--keep-duplicates")
+        {
+            options.removeDuplicates = false;
+        }
+        else
+        {
+            usage();
+        }
+        args.erase(args.begin());
+    }
+    if(args.size() < 2)
+    {
+        usage();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<VertexId> sources;
+    std::string output;
+
+    if(args[0] == "-e")
+    {
+        if(args.size() < 3)
+        {
+            usage();
+        }
+        EdgeListStats stats;
+        CsrGraph g = readEdgeList(args[1], options, stats);
+        std::cout << "read " << stats.lines << " edges in " << stats.seconds << " s (" << stats.edgesPerSecond() << " edges/s), dropped "
+                  << stats.selfLoops << " self-loops and " << stats.duplicates / 2 << " duplicates" << std::endl;
+        output = args[2];
+        for(std::size_t i = 3; i < args.size(); ++i)
+        {
+            std::size_t id = std::stoull(args[i]);
+            if(id > g.maxNodeId() || g.denseId(id) == INVALID_VERTEX)
+            {
+                throw std::runtime_error("source " + args[i] + " is not a vertex of the graph");
+            }
+            sources.push_back(g.denseId(id));
+        }
+        writeOrdered(output, g, sources, ordering);
+        std::cout << g.nodeNum() << " nodes, " << g.edgeNum() / 2 << " edges";
+    }
+    else
+    {
+        std::size_t sourceNum = 3;
+        std::size_t first = 0;
+        if(args[0] == "-s")
+        {
+            if(args.size() < 4)
+            {
+                usage();
+            }
+            sourceNum = std::stoul(args[1]);
+            first = 2;
+        }
+
+        ListGraph readInGraph;
+        std::vector<Node> sourceNodes(sourceNum);
+        GraphReader<ListGraph> reader(readInGraph, args[first]);
+        for(std::size_t i = 1; i <= sourceNum; ++i)
+        {
+            reader.node("source" + std::to_string(i), sourceNodes[i - 1]);
+        }
+        reader.run();
+
+        CsrGraph g(readInGraph);
+        for(auto s: sourceNodes)
+        {
+            sources.push_back(g.denseId(readInGraph.id(s)));
+        }
+        output = args[first + 1];
+        writeOrdered(output, g, sources, ordering);
+        std::cout << g.nodeNum() << " nodes, " << g.edgeNum() / 2 << " edges";
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << ", " << sources.size() << " sources written to " << output << " in " << elapsed.count() << " s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "LabelKernels.h"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+// Microbenchmark of the label kernels on 256 and 512 bit batches.
+// It replays the per-edge pattern of the traversal (OR of a random neighbour's label, then
+// AND-NOT seen, test for zero and popcount) with every SIMD level the CPU supports.
+
+const std::size_t VERTEX_NUM = 1 << 16;
+const std::size_t EDGE_NUM = 1 << 22;
+
+template <unsigned int bitsetSize>
+double runKernels(const std::vector<ParallelLabel>& frontier, std::vector<ParallelLabel>& next,
+                  const std::vector<ParallelLabel>& seen, const std::vector<std::uint32_t>& edges, std::size_t& checksum)
+{
+    const std::size_t words = LabelWords<bitsetSize>::count;
+    auto start = std::chrono::steady_clock::now();
+
+    for (std::size_t e = 0; e < edges.size(); e += 2)
+    {
+        ParallelLabel* nextLabel = &next[edges[e] * words];
+        labelOr<words>(nextLabel, &frontier[edges[e + 1] * words]);
+        labelAndNot<words>(nextLabel, &seen[edges[e] * words]);
+        if (!labelIsZero<words>(nextLabel))
+        {
+            checksum += labelCount<words>(nextLabel);
+        }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+template <unsigned int bitsetSize>
+void benchmark(std::mt19937_64& rng)
+{
+    const std::size_t words = LabelWords<bitsetSize>::count;
+    std::vector<ParallelLabel> frontier(VERTEX_NUM * words), seen(VERTEX_NUM * words), next(VERTEX_NUM * words);
+    std::vector<std::uint32_t> edges(2 * EDGE_NUM);
+
+    for (auto& w: frontier) w = rng() & rng(); // sparse-ish frontier
+    for (auto& w: seen) w = rng() | rng();
+    for (auto& v: edges) v = rng() % VERTEX_NUM;
+
+    double scalarTime = 0;
+    for (SimdLevel level: {SimdLevel::SCALAR, SimdLevel::AVX2, SimdLevel::AVX512})
+    {
+        if (setLabelSimdLevel(level) != level)
+        {
+            continue; // not supported by this CPU
+        }
+        std::fill(next.begin(), next.end(), 0);
+        std::size_t checksum = 0;
+        runKernels<bitsetSize>(frontier, next, seen, edges, checksum); // warm up
+        double time = runKernels<bitsetSize>(frontier, next, seen, edges, checksum);
+        if (level == SimdLevel::SCALAR)
+        {
+            scalarTime = time;
+        }
+
+        std::cout << std::setw(4) << bitsetSize << " bits  " << std::setw(7) << simdLevelName(level)
+                  << "  " << std::fixed << std::setprecision(2) << time * 1e9 / EDGE_NUM << " ns/edge"
+                  << "  speedup " << scalarTime / time << "x"
+                  << "  (checksum " << checksum << ")" << std::endl;
+    }
+    setLabelSimdLevel(SimdLevel::AVX512);
+}
+
+int main()
+{
+    std::mt19937_64 rng(42);
+    std::cout << "detected SIMD level: " << simdLevelName(labelSimdLevel()) << std::endl;
+    benchmark<256>(rng);
+    benchmark<512>(rng);
+    return 0;
+}